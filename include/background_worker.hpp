@@ -0,0 +1,56 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+// One thread running posted jobs in order. For work that must not hold up
+// the frame loop but is needed a few seconds later, e.g. the collages of
+// the next gameplay task.
+class background_worker
+{
+    public:
+        background_worker();
+
+        // Finishes the queued jobs, then joins
+        ~background_worker();
+
+        background_worker(const background_worker&) = delete;
+
+        background_worker& operator=(const background_worker&) = delete;
+
+        // Ready once the job has run
+        std::shared_future<void> post(std::function<void()> job);
+
+    private:
+        void run();
+
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::deque<std::packaged_task<void()>> jobs_;
+        bool stop_{false};
+        std::thread thread_;
+};
@@ -1,6 +1,6 @@
 /*
  *  Dino Math
- * 
+ *
  *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
  *
  *  This program is free software; you can redistribute it and/or modify
@@ -19,10 +19,13 @@
 
 #pragma once
 
-#include <screen/screen.hpp>
+#include <string>
+#include <vector>
 
-class sdl_screen : public screen
-{
+// Micro benchmarks run from the command line (--benchmark=NAME).
+// Results are printed to stdout.
 
+std::vector<std::string> benchmark_names();
 
-}
\ No newline at end of file
+// Returns false if the benchmark is unknown
+bool run_benchmark(std::string name);
@@ -26,8 +26,32 @@ constexpr double ref_height = 720;
 
 int64_t get_ts();
 
+// Same clock as get_ts() (CLOCK_MONOTONIC). Unit: ns
+int64_t get_ts_ns();
+
+// Time seen by game logic (unit: us). Set once per frame, so a replayed
+// frame sees the same time as the recorded one. get_ts() until set.
+int64_t get_game_ts();
+
+void set_game_ts(int64_t ts);
+
 struct coordinate
 {
     double x;
     double y;
 };
+
+// Axis aligned
+struct rect
+{
+    double x;
+    double y;
+    double width;
+    double height;
+};
+
+// Shared area, touching edges do not count
+bool overlaps(const rect& a, const rect& b);
+
+// Smallest rect containing both. Empty rects (no width or height) are ignored.
+rect united(const rect& a, const rect& b);
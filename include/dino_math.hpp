@@ -20,8 +20,15 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
-#include <user_interface/xlib_screen.hpp>
+#include <frame_scheduler.hpp>
+#include <input_log.hpp>
+#include <on_screen_display.hpp>
+#include <random_generator.hpp>
+#include <render_thread.hpp>
+#include <user_interface/screen.hpp>
 #include <user_interface/ui_event.hpp>
 #include <graphics_context/surface_cache.hpp>
 #include <graphics_context/rendering_context.hpp>
@@ -32,10 +39,28 @@ using scene_idx = size_t;
 class dino_math
 {
     public:
-        dino_math(int screen_width, int screen_height, bool fullscreen);
+        dino_math(int screen_width, int screen_height, bool fullscreen, bool latency_mode);
+
+        // Reproduce the tasks and layouts of an earlier run() (printed on
+        // start). Random otherwise.
+        void set_seed(uint64_t seed) { seed_ = seed; seed_set_ = true; }
+
+        // Record the input of run() to path (see input_log.hpp)
+        void record_input(const std::string& path) { record_path_ = path; }
+
+        // run() on xcb_screen instead of xlib_screen (DINO_MATH_XCB builds)
+        void use_xcb(bool enabled) { xcb_ = enabled; }
+
+        // Write each frame of replay() as a PNG into dir
+        void dump_frames(const std::string& dir) { frame_dump_dir_ = dir; }
 
         void run();
 
+        // Play an input log back against a headless screen, in real time
+        // or as fast as possible. Per frame digests of the screen go to
+        // digests_path if set.
+        bool replay(const std::string& path, bool unthrottled, const std::string& digests_path);
+
     private:
         double target_fps_;
         double current_fps_;
@@ -44,22 +69,52 @@ class dino_math
         int screen_width_;
         int screen_height_;
         bool fullscreen_;
+        bool latency_mode_;
+        bool xcb_{false};
+        bool replaying_{false};
 
         int64_t start_ts_;
 
-        std::shared_ptr<xlib_screen> screen_;
+        // Input accounting
+        uint64_t input_events_polled_{0};
+        uint64_t input_events_dispatched_{0};
+        uint64_t input_scene_draws_{0};
+
+        uint64_t seed_{0};
+        bool seed_set_{false};
+
+        std::shared_ptr<random_generator> rng_;
+
+        std::string record_path_;
+        std::string frame_dump_dir_;
+
+        std::shared_ptr<input_log_writer> recorder_;
+
+        std::shared_ptr<screen> screen_;
 
         std::shared_ptr<rendering_context> ctx_;
 
         std::shared_ptr<surface_cache> sur_cache_;
 
-        bool check_ui_events();
+        std::shared_ptr<frame_scheduler> scheduler_;
+
+        std::shared_ptr<on_screen_display> overlay_;
+
+        std::shared_ptr<render_thread> renderer_;
+
+        void init(uint64_t seed);
+        void draw_frame();
+        void finish();
+
+        void poll_ui_events();
+        void check_ui_events(frame_snapshot& frame);
         void draw_scene();
-        void draw_scene(ui_event ev);
+        void draw_scene(const ui_event& ev);
+        void add_latency_sample(frame_snapshot& frame, const ui_event& event, int64_t dispatch_ts);
         void draw_on_screen_display();
         void clear_on_screen_display();
         bool initial_expose_event_{false};
-        std::string elapsed_time_str(int64_t elapsed_time);
+        void record_frame_time(int64_t frame_time);
 
         void scene_init();
     
@@ -0,0 +1,88 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <type_traits>
+
+// View of contiguous events, valid until the owning queue is cleared
+template<typename T>
+class event_span
+{
+    public:
+        event_span(T* data, size_t size)
+         : data_(data)
+         , size_(size)
+        {}
+
+        T* begin() const { return data_; }
+
+        T* end() const { return data_ + size_; }
+
+        size_t size() const { return size_; }
+
+        bool empty() const { return size_ == 0; }
+
+        T& operator[](size_t i) const { return data_[i]; }
+
+    private:
+        T* data_;
+        size_t size_;
+};
+
+// Fixed capacity event storage, filled by the producer and emptied in one
+// go by the consumer. Never allocates. Events that do not fit are dropped
+// and counted.
+template<typename T, size_t capacity>
+class event_queue
+{
+    static_assert(std::is_trivially_copyable<T>::value, "events must be plain data");
+
+    public:
+        bool push(const T& event)
+        {
+            if (size_ == capacity) {
+                dropped_++;
+                return false;
+            }
+
+            events_[size_++] = event;
+            return true;
+        }
+
+        void clear() { size_ = 0; }
+
+        event_span<T> events() { return event_span<T>(events_.data(), size_); }
+
+        T& back() { return events_[size_ - 1]; }
+
+        bool empty() const { return size_ == 0; }
+
+        size_t size() const { return size_; }
+
+        uint64_t dropped() const { return dropped_; }
+
+    private:
+        std::array<T, capacity> events_;
+        size_t size_{0};
+        uint64_t dropped_{0};
+};
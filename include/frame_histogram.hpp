@@ -0,0 +1,61 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <string>
+
+// Log-linear histogram of durations (unit: us). Exact below 64 us, then 32
+// buckets per power of two (~3% resolution) up to 16 s. Fixed size, no
+// allocation when adding samples.
+class frame_histogram
+{
+    public:
+        void add(int64_t value);
+
+        void reset();
+
+        uint64_t count() { return count_; }
+
+        int64_t max() { return max_; }
+
+        double mean();
+
+        // Upper bound of the bucket holding percentile p (0-100)
+        int64_t percentile(double p);
+
+        // "p50 1.20 p95 2.05 p99 3.10 max 8.00 ms"
+        std::string summary();
+
+    private:
+        static constexpr int sub_bucket_bits = 5;
+        static constexpr int linear_limit = 64;
+        static constexpr int max_exponent = 24;
+        static constexpr int nr_buckets = linear_limit + (max_exponent - 6) * (1 << sub_bucket_bits);
+
+        static int bucket_index(int64_t value);
+        static int64_t bucket_upper_bound(int index);
+
+        std::array<uint32_t, nr_buckets> buckets_{};
+        uint64_t count_{0};
+        int64_t sum_{0};
+        int64_t max_{0};
+};
@@ -0,0 +1,97 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+
+#include <frame_histogram.hpp>
+#include <timer.hpp>
+
+struct frame_wakeup
+{
+    bool frame{false};    // frame tick, draw now
+    bool deadline{false}; // scene deadline reached
+    bool input{false};    // input fd readable
+    bool notify{false};   // notify() called
+};
+
+// Sleeps until there is something to do. The frame timer only runs while
+// frames are requested, a static screen costs no wakeups at all. Frames
+// are scheduled on absolute CLOCK_MONOTONIC deadlines one frame period
+// apart, so rounding errors do not accumulate.
+class frame_scheduler
+{
+    public:
+        frame_scheduler(double fps);
+
+        ~frame_scheduler();
+
+        void watch_input(int fd);
+
+        // Draw a frame at the next frame tick
+        void request_frame();
+
+        bool frame_requested() { return frame_requested_; }
+
+        // Wake up at ts (unit: us, see get_ts()). Zero: no deadline
+        void set_deadline(int64_t ts);
+
+        void set_fps(double fps);
+
+        // Thread safe. Wakes the scheduler, e.g. on async asset completion
+        void notify();
+
+        frame_wakeup wait();
+
+        void print_stats();
+
+    private:
+        void begin_idle();
+        void end_idle();
+        int64_t cpu_time(); // unit: us
+
+        timer timer_;
+        uint64_t frame_timer_id_{0};
+        uint64_t deadline_timer_id_{0};
+        uint64_t input_id_{0};
+        uint64_t notify_id_{0};
+        int notify_fd_{-1};
+
+        std::chrono::nanoseconds frame_period_;
+        int64_t next_frame_ts_{0}; // unit: ns
+        bool frame_requested_{true};
+        bool frame_timer_armed_{false};
+        int64_t deadline_{0};
+
+        // Frame timer expiration to wakeup
+        frame_histogram wake_latency_;
+
+        // Idle accounting (idle: no frame requested)
+        int64_t created_ts_{0};
+        bool idle_{false};
+        int64_t idle_start_ts_{0};
+        int64_t idle_start_cpu_{0};
+        int64_t idle_time_{0};
+        int64_t idle_cpu_time_{0};
+        uint64_t idle_periods_{0};
+        uint64_t idle_wakeups_{0};
+        uint64_t frames_{0};
+};
@@ -0,0 +1,74 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Compositing kernels operating on cairo's 32 bit premultiplied
+// ARGB pixel layout (CAIRO_FORMAT_ARGB32 and CAIRO_FORMAT_RGB24).
+// One kernel set exists per instruction set. The fastest set supported
+// by the running CPU is selected on first use. The selection may be
+// overridden with DINO_MATH_BLIT=scalar|sse41|avx2|neon.
+
+enum class blit_isa
+{
+    scalar,
+    sse41,
+    avx2,
+    neon,
+};
+
+struct blit_kernels
+{
+    const char* name;
+
+    blit_isa isa;
+
+    // dst = src
+    void (*copy)(uint32_t* dst, const uint32_t* src, int n);
+
+    // dst = src + dst * (1 - src_alpha)
+    void (*over)(uint32_t* dst, const uint32_t* src, int n);
+
+    // dst = src * alpha + dst * (1 - src_alpha * alpha), alpha: 0-255
+    void (*over_alpha)(uint32_t* dst, const uint32_t* src, int n, uint32_t alpha);
+
+    // dst = color
+    void (*fill)(uint32_t* dst, uint32_t color, int n);
+};
+
+const blit_kernels& blit_best_kernels();
+
+// nullptr if the kernel set is not supported by the build or the CPU
+const blit_kernels* blit_kernels_for(blit_isa isa);
+
+//---------------------------------------------------------------------------------------------------------------------------
+// Rectangle helpers. Pointers refer to the top left pixel, strides are in bytes.
+
+void blit_copy(const blit_kernels& k, uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int width, int height);
+
+void blit_over(const blit_kernels& k, uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int width, int height);
+
+void blit_over_alpha(const blit_kernels& k, uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int width, int height, uint32_t alpha);
+
+void blit_fill(const blit_kernels& k, uint8_t* dst, int dst_stride, int width, int height, uint32_t color);
+
+// Opaque premultiplied pixel from 0.0-1.0 components
+uint32_t blit_rgb(double r, double g, double b);
@@ -0,0 +1,95 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <memory>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "surface.hpp"
+
+// A finished collage is fully determined by these parameters
+struct collage_key
+{
+    uint64_t selection_id; // hash of the selected svg paths
+    int nr_dinos;
+    int nr_cols;
+    int nr_rows;
+    int width;
+    int height;
+    uint32_t seed;
+
+    bool operator<(const collage_key& other) const
+    {
+        return std::tie(selection_id, nr_dinos, nr_cols, nr_rows, width, height, seed) <
+               std::tie(other.selection_id, other.nr_dinos, other.nr_cols, other.nr_rows, other.width, other.height, other.seed);
+    }
+};
+
+struct collage_cache_stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t resident_bytes;
+};
+
+// Shared by the frame loop and the gameplay task worker
+class collage_cache
+{
+    public:
+        collage_cache(size_t max_bytes);
+
+        // nullptr if not cached
+        std::shared_ptr<surface> get(const collage_key& key);
+
+        void put(const collage_key& key, std::shared_ptr<surface> collage);
+
+        collage_cache_stats stats();
+
+        void print_stats();
+
+    private:
+        struct collage_entry
+        {
+            std::shared_ptr<surface> collage;
+            size_t bytes;
+            int64_t last_accessed;
+        };
+
+        // Caller holds mutex_
+        void evict_least_recently_used();
+
+        std::mutex mutex_;
+
+        std::map<collage_key,collage_entry> cache_;
+
+        size_t max_bytes_;
+
+        size_t resident_bytes_{0};
+
+        uint64_t hits_{0};
+
+        uint64_t misses_{0};
+
+        uint64_t evictions_{0};
+};
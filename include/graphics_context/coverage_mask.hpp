@@ -0,0 +1,64 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "surface.hpp"
+
+// One bit per pixel, set where the surface is (mostly) opaque. Rows are
+// padded to whole 64 bit words. Built once per hit tested sprite (see
+// surface_cache::get_svg_mask()) and never changed, so it is shared
+// without locking.
+class coverage_mask
+{
+    public:
+        // Null for surfaces without an alpha channel: every pixel is
+        // covered, the bounding rectangle is exact
+        static std::shared_ptr<const coverage_mask> create(std::shared_ptr<surface> s);
+
+        // Surface pixel coordinates, false outside the surface
+        bool covers(int x, int y) const
+        {
+            if (x < 0 || y < 0 || x >= width_ || y >= height_) {
+                return false;
+            }
+
+            return (bits_[static_cast<size_t>(y) * words_per_row_ + static_cast<size_t>(x >> 6)] >> (x & 63)) & 1;
+        }
+
+        size_t bytes() const { return bits_.size() * sizeof(uint64_t); }
+
+    private:
+        static constexpr uint32_t alpha_threshold = 128; // half covered edge pixels count
+
+        coverage_mask(int width, int height);
+
+        int width_;
+
+        int height_;
+
+        size_t words_per_row_;
+
+        std::vector<uint64_t> bits_;
+};
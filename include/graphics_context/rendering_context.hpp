@@ -21,6 +21,7 @@
 
 #include <user_interface/screen.hpp>
 #include <memory>
+#include <graphics_context/resident_cache.hpp>
 #include <graphics_context/surface.hpp>
 #include <common.hpp>
 
@@ -54,7 +55,20 @@ class rendering_context
                           double ref_width,
                           double ref_height,
                           anti_aliasing anti_aliasing);
-        
+
+        // Record drawing into a new recording surface instead of drawing on
+        // the screen, until end_frame() hands the recording over
+        void begin_frame();
+
+        std::shared_ptr<surface> end_frame();
+
+        // Draw into layer instead, until end_layer(). Its top left corner
+        // is at x, y (reference coordinates, rounded to whole pixels). Used
+        // to render scene content once, see scene::draw_static_layer().
+        void begin_layer(std::shared_ptr<surface> layer, double x = 0, double y = 0);
+
+        void end_layer();
+
         void set_source_rgb(double r, double g, double b);
         void set_source_rgba(double r, double g, double b, double a);
         void fill();
@@ -82,12 +96,54 @@ class rendering_context
 
 
 
+        // Immutable surfaces are drawn from their server side copy when the
+        // screen has one
         void draw_surface(std::shared_ptr<surface> surface, double x, double y, double alpha);
 
+        // A layer of begin_layer() at x, y, rounded the same way. Whole
+        // pixel offsets, so it is copied instead of filtered.
+        void draw_layer(std::shared_ptr<surface> layer, double x, double y);
+
+        // Only the part of it inside area (reference coordinates, widened
+        // to whole pixels)
+        void draw_surface_area(std::shared_ptr<surface> surface, double x, double y, const rect& area);
+
+        // Residency and client pixel traffic
+        void print_stats();
+
     private:
+        // Drawing state of the previous target carries over
+        void apply_state(cairo_t* cr);
+
+        // Device coordinates
+        void draw_surface_px(std::shared_ptr<surface> surface, double x, double y, double alpha);
+
         std::shared_ptr<screen> screen_;
         double ref_width_;
         double ref_height_;
         anti_aliasing anti_aliasing_;
         double scale_multiplier_;
+
+        // Screen, or the recording of the current frame
+        std::shared_ptr<surface> target_;
+
+        // Target to return to after end_layer()
+        std::shared_ptr<surface> layer_prev_target_;
+
+        // Reapplied to each new target
+        cairo_antialias_t cr_antialias_{CAIRO_ANTIALIAS_NONE};
+        std::string font_name_;
+        cairo_font_slant_t cr_font_slant_{CAIRO_FONT_SLANT_NORMAL};
+        cairo_font_weight_t cr_font_weight_{CAIRO_FONT_WEIGHT_NORMAL};
+        double cr_font_size_{10}; // cairo default
+
+        // nullptr if the screen is local (headless)
+        std::shared_ptr<resident_cache> residents_;
+
+        // Client side images drawn onto a remote screen, estimated as their
+        // pixel memory (unit: bytes)
+        uint64_t frames_{0};
+        uint64_t frame_upload_bytes_{0};
+        uint64_t upload_bytes_{0};
+        uint64_t max_frame_upload_bytes_{0};
 };
\ No newline at end of file
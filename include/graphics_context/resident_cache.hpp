@@ -0,0 +1,84 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+
+#include <graphics_context/surface.hpp>
+#include <user_interface/screen.hpp>
+
+struct resident_cache_stats
+{
+    uint64_t hits;
+    uint64_t uploads;
+    uint64_t evictions;
+    size_t entries;
+    size_t resident_bytes; // server memory
+};
+
+// Server side copies of immutable image surfaces (see
+// surface::set_immutable()). Drawn onto the window they are copies inside
+// the display server, instead of the pixels going over the connection
+// every frame. Copies go away with their image or when the budget is
+// exceeded, least recently drawn first. Logic thread only.
+class resident_cache
+{
+    public:
+        resident_cache(std::shared_ptr<screen> screen, size_t max_bytes);
+
+        // Resident copy of image, uploaded on first use. nullptr if it must
+        // be drawn from client memory.
+        std::shared_ptr<surface> get(const std::shared_ptr<surface>& image);
+
+        resident_cache_stats stats();
+
+    private:
+        struct resident_entry
+        {
+            std::weak_ptr<surface> image;
+            std::shared_ptr<surface> resident;
+            size_t bytes;
+            int64_t last_used;
+        };
+
+        std::shared_ptr<surface> upload(const std::shared_ptr<surface>& image);
+
+        // Entries whose image is gone
+        void purge_expired_entries();
+
+        void evict_least_recently_used();
+
+        std::shared_ptr<screen> screen_;
+
+        std::unordered_map<const surface*, resident_entry> entries_;
+
+        size_t max_bytes_;
+
+        size_t resident_bytes_{0};
+
+        uint64_t hits_{0};
+
+        uint64_t uploads_{0};
+
+        uint64_t evictions_{0};
+};
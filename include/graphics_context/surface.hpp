@@ -20,6 +20,7 @@
 #pragma once
 
 #include <string>
+#include <memory>
 #include <cairo.h>
 #include <librsvg/rsvg.h>
 
@@ -30,7 +31,9 @@ class surface
     public:
         surface();
 
-        surface(double width, double height);
+        // Opaque surfaces are created as CAIRO_FORMAT_RGB24 by
+        // load_background(): no alpha to store, blend or send
+        surface(double width, double height, bool opaque = false);
 
         surface(cairo_surface_t* surface, cairo_t* cr, double width, double height);
 
@@ -38,11 +41,14 @@ class surface
 
         void load_background(double r, double g, double b);
 
+        // ARGB32, transparent: cairo clears new image surfaces
+        void load_transparent();
+
         void load_from_svg(std::string path);
 
         void load_from_png(std::string path);
 
-        void write_png(std::string path);
+        bool write_png(std::string path);
 
         void draw_surface(std::shared_ptr<surface> surface, double x, double y, double alpha);
 
@@ -56,9 +62,37 @@ class surface
 
         double height() { return height_; }
 
+        // Pixels never change from here on. Such surfaces may be mirrored
+        // in display server memory (see resident_cache). Flushed once
+        // here: they are shared between threads, and cairo_surface_flush()
+        // detaches the snapshots recordings keep of them, without locking.
+        void set_immutable();
+
+        bool immutable() { return immutable_; }
+
+        // Every pixel is opaque (RGB24 image, depth 24 pixmap). Drawn with
+        // CAIRO_OPERATOR_SOURCE instead of blending.
+        bool opaque();
+
+        // Pixel memory of image surfaces, zero otherwise
+        size_t bytes();
+
+        // FNV-1a hash of the pixels of image surfaces, zero otherwise
+        uint64_t digest();
+
         void destroy();
 
     private:
+        bool is_image_surface();
+
+        bool has_identity_transform();
+
+        // The clip of cr_ keeps every pixel of the rectangle (device space)
+        bool clip_contains(int x, int y, int width, int height);
+
+        // SIMD fast path, returns false if cairo must be used
+        bool blit_surface(std::shared_ptr<surface> surface, double x, double y, double alpha);
+
         double width_;
 
         double height_;
@@ -67,6 +101,10 @@ class surface
 
         cairo_t* cr_{nullptr};
 
+        bool immutable_{false};
+
+        bool opaque_{false}; // requested format, see opaque()
+
         RsvgHandle* rsvg_;
 
         RsvgDimensionData dim_;
@@ -21,7 +21,9 @@
 
 #include <memory>
 #include <map>
+#include <mutex>
 
+#include "coverage_mask.hpp"
 #include "surface.hpp"
 
 using surface_key = std::string; // path + '_' + width + '_' + height
@@ -29,9 +31,24 @@ using surface_key = std::string; // path + '_' + width + '_' + height
 struct cache_entry
 {
     std::shared_ptr<surface> cached_surface;
+    std::shared_ptr<const coverage_mask> mask; // null if fully opaque
+    bool mask_built;                           // see get_svg_mask()
     int64_t last_accessed;
+    size_t bytes;
 };
 
+struct surface_cache_stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    size_t entries;
+    size_t resident_bytes;
+    int pending_loads;
+};
+
+// Shared by the frame loop and background workers. Lookups take a lock,
+// loads run outside of it; a surface loaded twice by concurrent misses is
+// kept once.
 class surface_cache
 {
     public:
@@ -41,7 +58,26 @@ class surface_cache
         
         std::shared_ptr<surface> get_png_surface(std::string path);
 
+        // Alpha coverage of a surface returned by get_svg_surface() with
+        // the same arguments, for sprites that are hit tested. Derived on
+        // the first call and kept with the surface. Null if not loaded or
+        // without alpha.
+        std::shared_ptr<const coverage_mask> get_svg_mask(std::string path, double width, double height);
+
+        surface_cache_stats stats();
+
+        // Off: SVGs are always rendered, nothing is read from or written to
+        // ~/.dino_math. PNG round trips of premultiplied alpha are lossy,
+        // so frames would depend on what earlier runs left on disk.
+        void set_persistent_cache(bool enabled) { persistent_cache_ = enabled; }
+
     private:
+        // Caller holds mutex_
+        std::shared_ptr<surface> lookup(const surface_key& key);
+
+        // Returns the cached surface if another thread got there first
+        std::shared_ptr<surface> insert(const surface_key& key, std::shared_ptr<surface> s);
+
         surface_key create_key(std::string path, double width, double height);
 
         void purge_outdated_entries();
@@ -61,11 +97,22 @@ class surface_cache
 
         std::shared_ptr<surface> load_from_persistent_cache(std::string path, double width, double height);
 
+        std::mutex mutex_;
+
         std::map<surface_key,cache_entry> cache_;
 
         int screen_width_;
 
         int screen_height_;
 
+        uint64_t hits_{0};
+
+        uint64_t misses_{0};
+
+        size_t resident_bytes_{0};
+
+        int pending_loads_{0}; // loads in progress, all threads
+
+        bool persistent_cache_{true};
 
 };
\ No newline at end of file
@@ -0,0 +1,67 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "surface.hpp"
+#include "surface_cache.hpp"
+
+// All thumbnails of a dino selection pre-scaled side by side into one
+// surface. Large collages are composed directly from the atlas pixels,
+// one destination scanline at a time.
+class thumbnail_atlas
+{
+    public:
+        thumbnail_atlas(std::shared_ptr<surface_cache> sur_cache,
+                        std::vector<std::string>& svg_paths,
+                        int thumbnail_width,
+                        int thumbnail_height);
+
+        int nr_thumbnails() { return nr_thumbnails_; }
+
+        int thumbnail_width() { return thumbnail_width_; }
+
+        int thumbnail_height() { return thumbnail_height_; }
+
+        // Draws thumbnail indices[i] into grid cell i (row major). The grid
+        // rows are split into bands filled by nr_threads threads.
+        void compose(std::shared_ptr<surface> dst, const std::vector<int>& indices, int nr_cols, int nr_threads);
+
+    private:
+        void compose_rows(uint8_t* dst_data,
+                          int dst_stride,
+                          int dst_width,
+                          int dst_height,
+                          const std::vector<int>& indices,
+                          int nr_cols,
+                          int row_begin,
+                          int row_end);
+
+        std::shared_ptr<surface> atlas_;
+
+        int nr_thumbnails_{0};
+
+        int thumbnail_width_;
+
+        int thumbnail_height_;
+};
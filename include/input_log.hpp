@@ -0,0 +1,92 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <event_queue.hpp>
+#include <user_interface/ui_event.hpp>
+
+// Binary log of the input dispatched in each frame. Together with the
+// game seed it is enough to replay a session frame by frame.
+//
+//   header: "DMIL", u32 version, u64 seed, i32 width, i32 height
+//   frame:  i64 ts, u16 nr_events, nr_events * event
+//   event:  i64 receive_ts, u32 server_ts, u8 type, u8 c, u16 buttons,
+//           i32 x, i32 y
+//
+// Host byte order. Times are relative to the start of the session
+// (unit: us), server_ts is X server time (unit: ms).
+
+class input_log_writer
+{
+    public:
+        ~input_log_writer();
+
+        bool open(const std::string& path, uint64_t seed, int width, int height, int64_t start_ts);
+
+        // ts: game time of the frame (unit: us, see get_game_ts())
+        void write_frame(int64_t ts, event_span<ui_event> events);
+
+        void close();
+
+        uint64_t frames() { return frames_; }
+
+    private:
+        template<typename T>
+        void put(T value);
+
+        FILE* file_{nullptr};
+        int64_t start_ts_{0};
+        uint64_t frames_{0};
+        std::vector<uint8_t> buffer_;
+};
+
+class input_log_reader
+{
+    public:
+        ~input_log_reader();
+
+        bool open(const std::string& path);
+
+        uint64_t seed() { return seed_; }
+
+        int width() { return width_; }
+
+        int height() { return height_; }
+
+        // Next frame. Times relative to the start of the session. False at
+        // the end of the log.
+        bool read_frame(int64_t& ts, std::vector<ui_event>& events);
+
+        void close();
+
+    private:
+        template<typename T>
+        bool get(T& value);
+
+        FILE* file_{nullptr};
+        uint64_t seed_{0};
+        int width_{0};
+        int height_{0};
+};
@@ -31,7 +31,10 @@ class background_object : public object
 
         void draw() final;
 
-        void draw(ui_event ev);
+        void draw(const ui_event& ev);
+
+        // Both filled parts, i.e. the whole screen
+        rect bounds() override;
 
      private:
         double bg_r_{0};
@@ -41,7 +41,10 @@ class dashed_line_object : public object
         
         void draw() final;
 
-        void draw(ui_event ev);
+        void draw(const ui_event& ev);
+
+        // The line, widened by the line width
+        rect bounds() override;
 
      private:
         void internal_draw();
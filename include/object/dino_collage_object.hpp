@@ -23,7 +23,9 @@
 #include <string>
 
 #include <object/object.hpp>
+#include <graphics_context/collage_cache.hpp>
 #include <graphics_context/rendering_context.hpp>
+#include <graphics_context/thumbnail_atlas.hpp>
 
 struct grid
 {
@@ -36,6 +38,7 @@ class dino_collage_object : public object
     public:
         dino_collage_object(std::shared_ptr<rendering_context> ctx,
                             std::shared_ptr<surface_cache> sur_cache,
+                            std::shared_ptr<collage_cache> col_cache,
                             double x,
                             double y,
                             double width,
@@ -43,7 +46,17 @@ class dino_collage_object : public object
                             std::vector<std::string> selected_svg_paths,
                             int nr_dinos);
         
-        grid set_nr_dinos(int nr_dinos, grid grid_setup);
+        // Grid a collage of nr_dinos is drawn in
+        static grid fit_grid(int nr_dinos, grid grid_setup);
+
+        // Equal seeds give equal layouts for the same dino count and grid.
+        // Touches only the caches and the atlas, so it may run on another
+        // thread as long as only one thread builds at a time and the
+        // selection does not change meanwhile.
+        std::shared_ptr<surface> build_collage(int nr_dinos, grid grid_setup, uint32_t seed);
+
+        // Shows a collage from build_collage()
+        void set_collage(int nr_dinos, std::shared_ptr<surface> collage);
         
         int nr_dinos();
 
@@ -53,14 +66,19 @@ class dino_collage_object : public object
 
         void draw() final;
         
-        void draw(ui_event ev);
+        void draw(const ui_event& ev);
 
     private:
 
-        grid generate_collage(grid grid_setup);
+        std::shared_ptr<surface> render_collage(int nr_dinos, grid grid_setup, uint32_t seed);
 
+        std::shared_ptr<collage_cache> col_cache_;
         std::vector<std::string> selected_svg_paths_;
+        uint64_t selection_id_{0};
         int nr_dinos_;
+
+        std::shared_ptr<thumbnail_atlas> atlas_;
+        uint64_t atlas_selection_id_{0};
         bool visible_{true};
 };
 
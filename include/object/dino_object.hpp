@@ -20,6 +20,7 @@
 #pragma once
 
 #include <object/object.hpp>
+#include <graphics_context/coverage_mask.hpp>
 #include <graphics_context/rendering_context.hpp>
 
 class dino_object : public object
@@ -36,16 +37,36 @@ class dino_object : public object
 
         void draw() final;
 
-        void draw(ui_event ev);
+        void draw(const ui_event& ev);
+
+        // As it looks with the pointer elsewhere, for cached pages. Leaves
+        // the invalidation alone, the object itself may still be drawn.
+        void draw_resting();
+
+        // Includes the margin left of it and the name below it
+        rect bounds() override;
+
+        // Hover and selection
+        bool update(const ui_event& ev) override;
+
+        // Only where the dinosaur is drawn, not its transparent surroundings
+        bool intersect(double mouse_x, double mouse_y) override;
 
         bool is_selected();
 
+        // Looks like draw_resting() draws it
+        bool is_resting();
+
         std::string svg_path() { return svg_path_; }
 
         void unselect();
     private:
         void internal_draw();
 
+        void paint(bool hover, double alpha);
+
+        double resting_alpha();
+
         std::string svg_path_;
 
         std::string dino_name_;
@@ -55,5 +76,7 @@ class dino_object : public object
         bool selected_{false};
 
         std::shared_ptr<surface> checkmark_surface_;
+
+        std::shared_ptr<const coverage_mask> mask_; // null: whole rectangle
 };
 
@@ -0,0 +1,59 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <common.hpp>
+
+class object;
+
+// Objects to draw in the next frame, kept in drawing order. Intrusive: an
+// object links through its own fields, so queueing never allocates and an
+// object is queued at most once. Objects are queued by invalidate() and
+// the setters that change how they look (see scene::add_object()).
+//
+// A queued object paints over whatever lies above it within its bounds().
+// draw() queues those objects too, so overlaps are repainted without the
+// scenes having to know about them.
+class dirty_list
+{
+    public:
+        // Drawn above the objects added before it
+        void add(object* obj);
+
+        void push(object* obj);
+
+        // Queues the objects whose bounds overlap r, e.g. after something
+        // outside the list was drawn there
+        void damage(const rect& r);
+
+        // Draws the queued objects and the ones above them they overlap,
+        // lowest first. Objects queued meanwhile stay queued for the next
+        // call.
+        void draw();
+
+        bool empty() const { return head_ == nullptr; }
+
+    private:
+        std::vector<object*> objects_; // z order
+        object* head_{nullptr};
+};
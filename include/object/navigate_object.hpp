@@ -46,7 +46,12 @@ class navigate_object : public object
                         navigation_state nav_state);
 
         void draw() final;
-        void draw(ui_event ev);
+
+        // Same as update(), changes are drawn by draw()
+        void draw(const ui_event& ev);
+
+        // Hover and selection
+        bool update(const ui_event& ev) override;
 
         void change_state(navigation_state nav_state);
         navigation_state state();
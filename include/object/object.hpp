@@ -27,6 +27,8 @@
 #include <graphics_context/surface.hpp>
 #include <graphics_context/surface_cache.hpp>
 
+class dirty_list;
+
 struct state
 {
     double angle;
@@ -45,11 +47,21 @@ class object
 
         virtual void draw() = 0;
 
-        virtual void draw(ui_event ev) = 0;
+        virtual void draw(const ui_event& ev) = 0;
+
+        // Input, without drawing. Returns true if the object looks
+        // different now, it is then invalidated.
+        virtual bool update(const ui_event& ev) { return false; }
 
+        // Area painted by draw() (reference coordinates). May reach outside
+        // the object, e.g. for a name drawn below it.
+        virtual rect bounds();
+
+        // Painted areas overlap
         bool intersect(object& obj);
 
-        bool intersect(double mouse_x, double mouse_y);
+        // Pointer hit. The rectangle (x, y, width, height), edges included.
+        virtual bool intersect(double mouse_x, double mouse_y);
 
         double x() { return state_.x; }
 
@@ -61,33 +73,61 @@ class object
 
         double height() { return state_.height; }
 
-        void set_x(double x) { state_.x = x; }
+        void set_x(double x);
 
-        void set_y(double y) { state_.y = y; }
+        void set_y(double y);
 
-        void set_visibility(bool visible) { visible_ = visible; }
+        void set_visibility(bool visible);
 
-        void set_angle(double angle) { state_.angle = angle; }
+        void set_angle(double angle);
 
+        // True if invalidated since the last draw. Nothing is compared, all
+        // changes to how an object looks must go through invalidate().
         bool state_changed();
 
-        void invalidate() { state_.invalidate = true; }
+        // Queues the object on its dirty list, if it has one
+        void invalidate();
+
+        bool invalidated() { return state_.invalidate; }
 
         void draw_object_bg();
 
         void draw_object_border();
 
+        // Objects visited (state_changed() called) and drawn (it returned
+        // true) since the last reset. Overlap: invalidated because an object
+        // below them was drawn (see dirty_list).
+        static uint64_t visit_count() { return visit_count_; }
+
+        static uint64_t redraw_count() { return redraw_count_; }
+
+        static uint64_t overlap_count() { return overlap_count_; }
+
+        static void reset_redraw_count() { visit_count_ = 0; redraw_count_ = 0; overlap_count_ = 0; }
+
     protected:
-        bool visible_;
+        static uint64_t visit_count_;
 
-        state state_;
+        static uint64_t redraw_count_;
 
-        state prev_state_;
+        static uint64_t overlap_count_;
+
+        bool visible_{true};
+
+        state state_;
 
         std::shared_ptr<rendering_context> ctx_;
 
         std::shared_ptr<surface_cache> sur_cache_;
 
         std::shared_ptr<surface> surface_;
+
+    private:
+        friend class dirty_list;
+
+        dirty_list* dirty_list_{nullptr};
+        object* dirty_next_{nullptr};
+        bool dirty_queued_{false};
+        int z_{0};
 };
 
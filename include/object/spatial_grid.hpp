@@ -0,0 +1,52 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <common.hpp>
+
+class object;
+
+// Uniform grid over the reference screen. Each cell lists the objects whose
+// hit area (x, y, width, height) touches it, so a point query only looks at
+// the few objects near it.
+class spatial_grid
+{
+    public:
+        void insert(object* obj);
+
+        void clear();
+
+        // Objects near x, y. Candidates only: check object::intersect().
+        const std::vector<object*>& cell(double x, double y);
+
+    private:
+        static constexpr double cell_size = 80; // reference units
+        static constexpr int nr_cols = static_cast<int>((ref_width + cell_size - 1) / cell_size);
+        static constexpr int nr_rows = static_cast<int>((ref_height + cell_size - 1) / cell_size);
+
+        static int col(double x);
+        static int row(double y);
+
+        std::array<std::vector<object*>, nr_cols * nr_rows> cells_;
+        std::vector<object*> outside_; // always empty
+};
@@ -28,7 +28,10 @@ class splash_screen_object : public object
         splash_screen_object(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache, double x, double y, double width, double height);
 
         void draw() final;
-        void draw(ui_event ev);
+        void draw(const ui_event& ev);
+
+        // Drawn from the top left corner of the screen
+        rect bounds() override;
 
 };
 
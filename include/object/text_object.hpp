@@ -35,7 +35,10 @@ class text_object : public object
                         double str_size);
 
         void draw() final;
-        void draw(ui_event ev);
+        void draw(const ui_event& ev);
+
+        // Background, it reaches a third of the font size up and left
+        rect bounds() override;
 
         void set_text(std::string str);
         void set_size(double size);
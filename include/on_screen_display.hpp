@@ -0,0 +1,91 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <memory>
+
+#include <frame_histogram.hpp>
+#include <graphics_context/rendering_context.hpp>
+#include <graphics_context/surface.hpp>
+#include <graphics_context/surface_cache.hpp>
+
+constexpr int osd_graph_samples = 120;
+
+struct osd_values
+{
+    double fps;
+    double target_fps;
+    int64_t elapsed_time; // unit: us
+    frame_histogram* frame_times;
+    surface_cache_stats cache_stats;
+    uint64_t visits;   // objects checked for changes this frame
+    uint64_t redraws;  // objects drawn this frame
+    uint64_t overlaps; // of these, drawn because an object below was
+};
+
+// Debug overlay (backtick). Everything is allocated up front: text is
+// formatted into a fixed buffer and composed from a pre-rendered glyph
+// atlas into a panel surface, which is put on screen with one paint.
+// Two panels take turns, the previous frame may still be on its way to
+// the screen.
+class on_screen_display
+{
+    public:
+        on_screen_display(std::shared_ptr<rendering_context> ctx);
+
+        // Frame graph sample (unit: us)
+        void add_frame_time(int64_t frame_time);
+
+        void draw(const osd_values& values);
+
+        // Area covered on screen (reference coordinates)
+        double width() { return panel_width; }
+
+        double height() { return panel_height; }
+
+    private:
+        static constexpr double panel_width = 600;
+        static constexpr double panel_height = 160;
+        static constexpr int first_glyph = 32;
+        static constexpr int nr_glyphs = 95; // printable ASCII
+
+        void build_glyph_atlas();
+        void draw_text(int x, int y, const char* str);
+        void draw_graph(int x, int y, int width, int height, double target_fps);
+
+        std::shared_ptr<rendering_context> ctx_;
+
+        std::array<std::shared_ptr<surface>, 2> panels_;
+        std::shared_ptr<surface> panel_; // the one drawn this frame
+        size_t frame_{0};
+        std::shared_ptr<surface> glyphs_;
+
+        std::array<int, nr_glyphs> glyph_advance_{};
+        int glyph_cell_width_{0};
+        int glyph_height_{0};
+        int line_height_{0};
+
+        std::array<int64_t, osd_graph_samples> frame_times_{};
+        size_t frame_time_head_{0};
+
+        char line_[128];
+};
@@ -0,0 +1,69 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+// Scoped zone profiler. Build with -DDINO_MATH_PROFILER=ON, otherwise
+// PROFILE_ZONE() expands to nothing.
+//
+//   void text_object::draw()
+//   {
+//       PROFILE_ZONE("text_object::draw");
+//       ...
+//   }
+//
+// Zones are recorded into a ring buffer per thread (newest entries win) and
+// written as Chrome trace_event JSON on exit, see profiler_write_trace().
+// Open the file in chrome://tracing or https://ui.perfetto.dev
+
+#ifdef DINO_MATH_PROFILER
+
+#include <stdint.h>
+
+// name must outlive the program (string literal)
+class profile_zone
+{
+    public:
+        profile_zone(const char* name);
+
+        ~profile_zone();
+
+        profile_zone(const profile_zone&) = delete;
+
+        profile_zone& operator=(const profile_zone&) = delete;
+
+    private:
+        const char* name_;
+        int64_t begin_ts_; // unit: ns
+};
+
+// Writes all rings to path (env DINO_MATH_TRACE if set)
+void profiler_write_trace(const char* path);
+
+#define PROFILE_ZONE_CONCAT_(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) profile_zone PROFILE_ZONE_CONCAT(profile_zone_, __LINE__)(name)
+
+#else
+
+#define PROFILE_ZONE(name) do {} while (0)
+
+inline void profiler_write_trace(const char*) {}
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+
+// xoshiro256** pseudo random generator, seeded through splitmix64. A few
+// ns per number, no system calls, and the same sequence on every platform
+// for a given seed (unlike std::uniform_int_distribution). One instance
+// is shared by the game so a run can be reproduced from its seed, see
+// --seed.
+class random_generator
+{
+    public:
+        using result_type = uint64_t;
+
+        explicit random_generator(uint64_t seed = 0) { this->seed(seed); }
+
+        void seed(uint64_t seed)
+        {
+            for(auto&& s : s_) {
+                seed += 0x9e3779b97f4a7c15ULL;
+                s = splitmix64(seed);
+            }
+        }
+
+        // Finalizer of splitmix64. Nearby inputs give unrelated outputs,
+        // e.g. for deriving independent seeds from one seed.
+        static uint64_t splitmix64(uint64_t z)
+        {
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        static constexpr result_type min() { return 0; }
+
+        static constexpr result_type max() { return UINT64_MAX; }
+
+        result_type operator()()
+        {
+            auto result = rotl(s_[1] * 5, 7) * 9;
+            auto t = s_[1] << 17;
+
+            s_[2] ^= s_[0];
+            s_[3] ^= s_[1];
+            s_[1] ^= s_[2];
+            s_[0] ^= s_[3];
+            s_[2] ^= t;
+            s_[3] = rotl(s_[3], 45);
+
+            return result;
+        }
+
+        // Uniform in [range_begin, range_end], without modulo bias
+        int uniform(int range_begin, int range_end)
+        {
+            auto range = static_cast<uint64_t>(static_cast<int64_t>(range_end) - range_begin) + 1;
+
+            // Lemire: multiply and reject the few values of the short interval
+            auto m = static_cast<unsigned __int128>((*this)()) * range;
+            auto low = static_cast<uint64_t>(m);
+            if (low < range) {
+                auto threshold = -range % range;
+                while (low < threshold) {
+                    m = static_cast<unsigned __int128>((*this)()) * range;
+                    low = static_cast<uint64_t>(m);
+                }
+            }
+
+            return range_begin + static_cast<int>(m >> 64);
+        }
+
+    private:
+        static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        std::array<uint64_t, 4> s_;
+};
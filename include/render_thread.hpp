@@ -0,0 +1,140 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <frame_histogram.hpp>
+#include <spsc_queue.hpp>
+#include <graphics_context/surface.hpp>
+#include <user_interface/screen.hpp>
+
+constexpr size_t render_queue_size = 4; // frames in flight
+constexpr size_t frame_latency_samples = 16; // per frame, latency mode
+
+// One input event followed from the X server to the screen
+struct latency_sample
+{
+    int64_t server_ts;   // unit: us, X server time on the local clock, 0 if unknown
+    int64_t receive_ts;  // unit: us, read from the connection
+    int64_t dispatch_ts; // unit: us, scene draw(ui_event) called
+    int64_t drawn_ts;    // unit: us, scene draw(ui_event) returned
+};
+
+// Everything the render thread needs for one frame. The logic thread does
+// not touch it after submit(); surfaces referenced by the recording are
+// snapshotted by cairo, so later changes to them do not leak in. The
+// snapshot lists are shared with the logic thread, see cairo_mutex().
+struct frame_snapshot
+{
+    std::shared_ptr<surface> recording; // drawing commands of the frame
+    int64_t submit_ts{0};               // unit: us
+    int nr_input_events{0};             // input drawn in this frame
+    int64_t earliest_input_ts{0};       // unit: us
+    int64_t input_ts_sum{0};            // unit: us
+
+    // Latency mode only
+    std::array<latency_sample, frame_latency_samples> latency_samples;
+    size_t nr_latency_samples{0};
+};
+
+// Replays frame recordings onto the window and presents them. Input and
+// game logic stay on the calling thread, which keeps drawing the next frame
+// while a heavy one is still being rasterized.
+class render_thread
+{
+    public:
+        render_thread(std::shared_ptr<screen> screen);
+
+        ~render_thread();
+
+        // Logic thread. Blocks only while render_queue_size frames are
+        // already waiting.
+        void submit(frame_snapshot&& frame);
+
+        // Presents what is queued, then joins the thread
+        void stop();
+
+        // Cairo keeps a list of snapshots on every surface a recording
+        // draws with, without locking. Held by the logic thread from
+        // begin_frame() to end_frame(), and by the render thread while it
+        // replays and releases a recording. Not held across submit().
+        std::mutex& cairo_mutex() { return cairo_mutex_; }
+
+        // Wait for the server after each present and report the latency
+        // samples of each frame. Call before the first submit().
+        void set_latency_mode(bool enabled) { latency_mode_ = enabled; }
+
+        // Hash the screen after every frame (image surface screens only).
+        // Call before the first submit().
+        void set_frame_digests(bool enabled) { frame_digests_enabled_ = enabled; }
+
+        // After stop(), one per submitted frame
+        const std::vector<uint64_t>& frame_digests() { return frame_digests_; }
+
+        // After stop()
+        void print_stats();
+
+    private:
+        void run();
+        void render(frame_snapshot& frame);
+        void add_latency_samples(const frame_snapshot& frame, int64_t present_ts);
+        void print_latency_stats();
+
+        std::shared_ptr<screen> screen_;
+
+        spsc_queue<frame_snapshot, render_queue_size> queue_;
+        int wake_fd_{-1}; // frame queued or stop
+        int done_fd_{-1}; // frame taken off the queue
+        std::atomic<bool> stop_{false};
+        std::mutex cairo_mutex_;
+        bool latency_mode_{false};
+        bool frame_digests_enabled_{false};
+        std::thread thread_;
+
+        // Render thread only
+        frame_histogram render_times_;  // unit: us, replay and present
+        frame_histogram queue_latency_; // unit: us, submit to present
+        uint64_t frames_{0};
+        uint64_t empty_frames_{0};
+        uint64_t input_latency_count_{0};
+        int64_t input_latency_sum_{0}; // unit: us
+        int64_t input_latency_max_{0}; // unit: us
+
+        // Latency mode (unit: us)
+        frame_histogram server_to_receive_;
+        frame_histogram receive_to_dispatch_;
+        frame_histogram scene_draw_;
+        frame_histogram drawn_to_present_;
+        frame_histogram server_to_present_;
+        frame_histogram receive_to_present_;
+        uint64_t latency_samples_{0};
+
+        std::vector<uint64_t> frame_digests_;
+
+        // Logic thread only
+        uint64_t queue_full_waits_{0};
+};
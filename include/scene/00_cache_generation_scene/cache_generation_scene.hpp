@@ -32,7 +32,9 @@ class cache_generation_scene : public scene
     public:
         cache_generation_scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache);
 
+        const char* name() final { return "cache generation"; }
+
         void draw() final;
-        void draw(ui_event ev) final;
+        void draw(const ui_event& ev) final;
 };
 
@@ -32,9 +32,12 @@ class splash_screen_scene : public scene
     public:
         splash_screen_scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache);
 
+        const char* name() final { return "splash screen"; }
+
         void draw() final;
-        void draw(ui_event ev) final;
+        void draw(const ui_event& ev) final;
         void begin() final;
+        int64_t next_deadline() final;
 
     private:
         int64_t started_ts_{0};
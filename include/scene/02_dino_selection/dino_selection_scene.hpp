@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <array>
 #include <vector>
 #include <memory>
 #include <vector>
@@ -51,6 +52,16 @@ struct dino_selection_page
   std::string bottom_right_name;
   std::string bottom_right_path;
   std::shared_ptr<dino_object> bottom_right_object;
+
+  // All four objects composed as they look with the pointer elsewhere.
+  // Outdated once the selection differs from rendered_selection.
+  std::shared_ptr<surface> rendered;
+  uint32_t rendered_selection{0}; // bit per objects() entry
+
+  std::array<std::shared_ptr<dino_object>, 4> objects()
+  {
+    return { top_left_object, top_right_object, bottom_left_object, bottom_right_object };
+  }
 };
 
 class dino_selection_scene : public scene
@@ -58,22 +69,66 @@ class dino_selection_scene : public scene
     public:
         dino_selection_scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache);
 
+        const char* name() final { return "dino selection"; }
+
         void draw() final;
-        void draw(ui_event ev) final;
+        void draw(const ui_event& ev) final;
+
+        void invalidate() final;
+
+        void invalidate(const rect& r) final;
+
+        // Frames of a page transition, and of rendering pages ahead of one
+        int64_t next_deadline() final;
 
         std::vector<std::string> get_all_svg_paths();
 
     private:
         dino_selection_page load_page(size_t page_idx);
-        void invalidate_pages();
         int nr_selected_dinos();
 
         void determine_selected_svg_paths();
 
+        // Selected objects of a page, bit per objects() entry
+        uint32_t page_selection(size_t page_idx);
+
+        // Cached and up to date
+        bool page_ready(size_t page_idx);
+
+        // Cached page surface, rendered if needed. Only the current page and
+        // its neighbours are kept.
+        std::shared_ptr<surface> page_surface(size_t page_idx);
+
+        // Renders one page a slide may need next (the current page and its
+        // neighbours) if it is not ready. Returns false if all are.
+        bool prefetch_page();
+
+        bool pages_pending();
+
+        // Slide from page from_idx to the current page. direction: 1 when
+        // the new page comes in from the right, -1 from the left.
+        void start_transition(size_t from_idx, int direction);
+
+        // Current page, or a frame of the transition
+        void draw_page();
+
+        // Objects of the current page that changed (hover, selection), over
+        // the cached page. Not while it slides in.
+        void draw_page_objects();
 
+        // Navigation and current page objects
+        void update_pointer_objects();
 
         size_t page_idx_{0};
         std::vector<dino_selection_page> pages_;
+        bool page_drawn_{false};
+        bool input_frame_{false}; // no prefetching in this frame
+
+        std::shared_ptr<surface> transition_from_;
+        std::shared_ptr<surface> transition_to_;
+        int transition_direction_{0};
+        int64_t transition_ts_{0};       // zero: no transition. unit: us
+        int64_t transition_frame_ts_{0}; // unit: us
 
         std::shared_ptr<navigate_object> left_nav_object_;
         std::shared_ptr<navigate_object> right_nav_object_;
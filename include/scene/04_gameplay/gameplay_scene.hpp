@@ -20,9 +20,14 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <deque>
+#include <future>
 #include <memory>
+#include <tuple>
 #include <vector>
 
+#include <background_worker.hpp>
 #include <graphics_context/rendering_context.hpp>
 #include <graphics_context/surface_cache.hpp>
 #include <object/dino_object.hpp>
@@ -30,28 +35,61 @@
 #include <object/object.hpp>
 #include <object/text_object.hpp>
 #include <object/dino_collage_object.hpp>
+#include <random_generator.hpp>
 #include <scene/scene.hpp>
 
+constexpr size_t task_collages = 5; // left side, right side, three answer parts
+constexpr size_t tasks_ahead = 2;    // generated and built while a task is shown
+
+struct task_collage
+{
+    int nr_dinos{0};
+    grid grid_setup{0, 0};
+    uint32_t seed{0}; // layout, derived from the task's collage_seed
+    std::shared_ptr<surface> collage; // set by the task worker
+};
+
+// One equation and its collages. Generated on the logic thread so random
+// draws keep their order; the collages are built by the task worker and
+// may only be read once built is ready.
+struct gameplay_task
+{
+    int left_operand{0};
+    int right_operand{0};
+    char op{'+'};
+    int answer{0};
+    int level{1};
+    int iteration{1};
+    uint32_t collage_seed{0}; // layout variant of the task
+    std::array<task_collage, task_collages> collages;
+    std::shared_future<void> built;
+};
+
 class gameplay_scene : public scene
 {
     public:
-        gameplay_scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache);
+        gameplay_scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache, std::shared_ptr<random_generator> rng);
+
+        const char* name() final { return "gameplay"; }
 
         void draw() final;
-        void draw(ui_event ev) final;
+        void draw(const ui_event& ev) final;
 
         void simulate_gameplay(std::vector<std::string>& selected_svg_paths);
 
+        void print_statistics() final;
+
+        int64_t next_deadline() final;
+
     private:
+        // Task generator state, tasks_ahead tasks ahead of the screen
         int level_{1};
-        int iteration_{1};
+        int iteration_{0};
         int total_steps_{3};
-        int points_{0};
         int left_operand_min_{2};
         int left_operand_delta_{5};
         int right_operand_delta_{5};
 
-
         int left_operand_{0};
         int right_operand_{0};
 
@@ -59,9 +97,19 @@ class gameplay_scene : public scene
         int prev_left_operand_{0};
         int prev_right_operand_{0};
 
-        char operator_;
         int answer_{0};
 
+        int points_{0};
+
+        std::shared_ptr<random_generator> rng_;
+
+        std::shared_ptr<gameplay_task> task_; // on screen
+        std::deque<std::shared_ptr<gameplay_task>> upcoming_;
+        std::shared_ptr<background_worker> worker_;
+
+        uint64_t tasks_shown_{0};
+        uint64_t tasks_waited_{0};   // next_task() blocked on the worker
+        int64_t max_task_wait_{0};   // unit: us
 
         int random_value(int range_begin, int range_end);
 
@@ -72,6 +120,11 @@ class gameplay_scene : public scene
 
         bool correct_ts_has_expired();
 
+        std::shared_ptr<gameplay_task> generate_task();
+        void build_task(std::shared_ptr<gameplay_task> task);
+        void fill_upcoming_tasks();
+        void wait_upcoming_tasks();
+
         void next_task();
         void reset_gameplay_state();
 
@@ -82,6 +135,9 @@ class gameplay_scene : public scene
         int64_t correct_ts_{0};
         int64_t task_ts_{0};
         int64_t task_elapsed_time_{0};
+
+        // Values shown by status_text_obj_
+        std::tuple<int, int, int, int, int64_t> status_values_{-1, -1, -1, -1, -1};
         
         int expr_left_side_{0};
         int expr_right_side_{0};
@@ -96,9 +152,12 @@ class gameplay_scene : public scene
         std::shared_ptr<dino_collage_object> middle_answer_collage_obj_;
         std::shared_ptr<dino_collage_object> right_answer_collage_obj_;
 
-        std::shared_ptr<text_object> collage_operator_obj_;
+        // Above in gameplay_task::collages order
+        std::array<std::shared_ptr<dino_collage_object>, task_collages> collage_objs_;
 
-        std::vector<std::shared_ptr<object>> dashed_line_objs_;
+        std::shared_ptr<collage_cache> collage_cache_;
+
+        std::shared_ptr<text_object> collage_operator_obj_;
 
         
 };
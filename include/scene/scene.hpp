@@ -22,7 +22,10 @@
 #include <vector>
 #include <memory>
 
+#include <frame_histogram.hpp>
+#include <object/dirty_list.hpp>
 #include <object/object.hpp>
+#include <object/spatial_grid.hpp>
 #include <user_interface/ui_event.hpp>
 #include <graphics_context/rendering_context.hpp>
 #include <graphics_context/surface_cache.hpp>
@@ -33,30 +36,94 @@ class scene
 
         scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache);
 
+        // Objects keep a pointer to the dirty list of the scene that added
+        // them, so a scene stays where it was constructed
+        scene(const scene&) = delete;
+        scene& operator=(const scene&) = delete;
+        scene(scene&&) = delete;
+        scene& operator=(scene&&) = delete;
+
+        // Drawn by draw_dirty_objects() when invalidated, in the order added
         void add_object(std::shared_ptr<object> object);
 
-        void invalidate();
+        // Content that does not change while the scene is shown. Rendered
+        // once into a cached surface, see draw_static_layer().
+        void add_static_object(std::shared_ptr<object> object);
+
+        // Drop the cached static layer, it is rendered again on next draw
+        void rebuild_static_layer();
+
+        // Repaint everything
+        virtual void invalidate();
+
+        // Repaint r (reference coordinates): the static layer under it and
+        // the objects over it
+        virtual void invalidate(const rect& r);
 
         void set_selected_svg_paths(std::vector<std::string> selection) { selected_svg_paths_ = selection; }
 
         std::vector<std::string> selected_svg_paths() { return selected_svg_paths_; }
 
+        virtual const char* name() = 0;
+
         virtual void draw() = 0;
 
-        virtual void draw(ui_event ev) = 0;
+        virtual void draw(const ui_event& ev) = 0;
 
         virtual void begin() {};
 
+        // Absolute time (unit: us, see get_game_ts()) at which draw() must run
+        // even without input. Zero: no deadline
+        virtual int64_t next_deadline() { return 0; }
+
+        // Printed when the game exits
+        virtual void print_statistics() {};
+
         void end() { ended_ = true; }
 
         bool ended() { return ended_; }
 
+        // Time to draw and present each frame of this scene
+        frame_histogram& frame_times() { return frame_times_; }
+
     protected:
+        // Puts the invalidated area of the static layer on screen, rendering
+        // it first if needed (also when the screen size changed). Returns
+        // true if anything was drawn, the objects over it are then
+        // invalidated.
+        bool draw_static_layer();
+
+        // Draws the invalidated objects added with add_object(), and the
+        // ones above them they paint over
+        void draw_dirty_objects() { dirty_.draw(); }
+
+        // Something else was drawn over r, objects there are drawn again
+        void damage(const rect& r) { dirty_.damage(r); }
+
+        void invalidate_objects();
+
+        // Objects given pointer events by pointer_targets(). All of them get
+        // the next event, so they start out knowing where the pointer is.
+        void set_pointer_objects(const std::vector<object*>& objects);
+
+        // The objects under the pointer and the ones it was over at the
+        // previous event, so they see it leave
+        const std::vector<object*>& pointer_targets(const ui_event& ev);
+
         std::shared_ptr<rendering_context> ctx_;
         std::shared_ptr<surface_cache> sur_cache_;
         std::vector<std::shared_ptr<object>> objects_;
+        dirty_list dirty_;
+        std::vector<std::shared_ptr<object>> static_objects_;
+        std::shared_ptr<surface> static_layer_;
+        rect static_damage_{0, 0, ref_width, ref_height}; // not yet put on screen
+
+        spatial_grid pointer_grid_;
+        std::vector<object*> under_pointer_;
+        std::vector<object*> pointer_targets_;
         std::vector<std::string> selected_svg_paths_;
         bool ended_{false};
+        frame_histogram frame_times_;
 };
 
 
@@ -0,0 +1,73 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <array>
+#include <atomic>
+#include <utility>
+
+// Lock-free ring between exactly one producer thread and one consumer
+// thread. push() and pop() never block and never allocate; the caller
+// decides what to do when the ring is full or empty.
+template<typename T, size_t capacity>
+class spsc_queue
+{
+    static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+    public:
+        // Producer only. item is left untouched when the ring is full.
+        bool push(T&& item)
+        {
+            auto head = head_.load(std::memory_order_relaxed);
+            if (head - tail_.load(std::memory_order_acquire) == capacity) {
+                return false;
+            }
+
+            items_[head & (capacity - 1)] = std::move(item);
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only
+        bool pop(T& item)
+        {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            if (head_.load(std::memory_order_acquire) == tail) {
+                return false;
+            }
+
+            item = std::move(items_[tail & (capacity - 1)]);
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Approximate when called while the other side is running
+        size_t size() const
+        {
+            return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+        }
+
+    private:
+        // Separate cache lines, the two sides do not share writes
+        alignas(64) std::atomic<size_t> head_{0};
+        alignas(64) std::atomic<size_t> tail_{0};
+        std::array<T, capacity> items_;
+};
@@ -26,22 +26,38 @@
 #include <chrono>
 #include <sys/epoll.h>
 
+#include <event_queue.hpp>
+
 constexpr int epoll_max_events = 200;
 
 class timer_event
 {
   public:
+    timer_event() = default;
+
     timer_event(uint64_t id)
      : id_(id)
      {}
 
-    uint64_t id()
+    timer_event(uint64_t id, uint64_t expirations)
+     : id_(id)
+     , expirations_(expirations)
+     {}
+
+    uint64_t id() const
     {
         return id_;
     }
 
+    // Number of timer periods elapsed since the last event (timers only)
+    uint64_t expirations() const
+    {
+        return expirations_;
+    }
+
   private:
-    uint64_t id_;
+    uint64_t id_{0};
+    uint64_t expirations_{0};
 };
 
 class timer
@@ -49,22 +65,65 @@ class timer
   public:
     timer();
 
+    ~timer();
+
+    timer(const timer&) = delete;
+
+    timer& operator=(const timer&) = delete;
+
     uint64_t register_one_shot_timer(std::chrono::milliseconds duration);
 
-    std::vector<std::shared_ptr<timer_event>> wait_for_events();
+    // Long lived timer, one event per period
+    uint64_t register_periodic_timer(std::chrono::nanoseconds period);
+
+    void set_period(uint64_t id, std::chrono::nanoseconds period);
+
+    // Long lived timer, created disarmed
+    uint64_t register_timer();
+
+    // Zero interval: fire once, then stay registered until armed again
+    void arm(uint64_t id, std::chrono::nanoseconds value, std::chrono::nanoseconds interval);
+
+    // Fire once at an absolute CLOCK_MONOTONIC time (see get_ts_ns())
+    void arm_at(uint64_t id, std::chrono::nanoseconds deadline);
+
+    void disarm(uint64_t id);
+
+    // Reports readability of an external file descriptor (e.g. X connection).
+    // The descriptor is not read.
+    uint64_t register_fd(int fd);
+
+    // Valid until the next call
+    event_span<timer_event> wait_for_events();
 
   private:
+    enum class source_type
+    {
+        one_shot_timer,
+        persistent_timer,
+        fd,
+    };
+
+    struct source
+    {
+        uint64_t id;
+        source_type type;
+    };
+
     void epoll_setup();
     void epoll_add(int fd);
+    void epoll_remove(int fd);
     void epoll_teardown();
-    void timerfd_set_timer();
-    void timerfd_teardown();
+    int timerfd_setup(std::chrono::nanoseconds duration, bool periodic);
+    void timerfd_arm(int timer_fd, std::chrono::nanoseconds value, std::chrono::nanoseconds interval, int flags = 0);
+    int fd_for_id(uint64_t id);
 
-    std::shared_ptr<timer_event> timerfd_handle_event(int fd);
+    // False for spurious wakeups
+    bool timerfd_handle_event(int fd, timer_event& event);
 
     int epoll_fd_;
     struct epoll_event epoll_events_[epoll_max_events];
-    std::unordered_map<int, uint64_t> timer_map_; // key: timer fd --> value: timer id
+    event_queue<timer_event, epoll_max_events> events_;
+    std::unordered_map<int, source> source_map_; // key: fd --> value: source
     uint64_t timer_id_{0};
 };
-
@@ -0,0 +1,67 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <event_queue.hpp>
+#include <graphics_context/surface.hpp>
+#include <user_interface/screen.hpp>
+#include <user_interface/ui_event.hpp>
+
+// Screen without a display server. The root surface is a plain image
+// surface and input is injected by the caller, e.g. input log replay.
+// Presented frames can be inspected through root_surface() (digest(),
+// write_png()) or dumped to a directory as they are presented.
+class headless_screen : public screen
+{
+    public:
+        headless_screen(int width, int height);
+
+        ~headless_screen();
+
+        // Synthetic input, delivered by the next poll_events(). The caller
+        // sets the receive time.
+        void push_event(const ui_event& event);
+
+        // Write every presented frame to dir/frame_NNNNNN.png. Call before
+        // the first present().
+        void set_frame_dump(const std::string& dir) { frame_dump_dir_ = dir; }
+
+        // Presented so far
+        uint64_t frames() { return frames_.load(std::memory_order_relaxed); }
+
+        event_span<ui_event> poll_events() override;
+
+        void present() override;
+
+        void close() override;
+
+    private:
+        event_queue<ui_event, ui_event_queue_size> injected_;
+
+        std::string frame_dump_dir_;
+        std::atomic<uint64_t> frames_{0}; // written by the presenting thread
+
+        bool closed_{false};
+};
@@ -21,21 +21,76 @@
 
 #include <memory>
 
+#include <event_queue.hpp>
 #include <graphics_context/surface.hpp>
+#include <user_interface/ui_event.hpp>
+
+constexpr size_t ui_event_queue_size = 256;
 
 class screen
 {
     public:
         screen(int width, int height);
 
+        virtual ~screen() = default;
+
         std::shared_ptr<surface> root_surface() { return root_surface_;}
 
         int width() { return width_; }
 
         int height() { return height_; }
 
+        // Appends new input to the pending events and returns all pending
+        // events
+        virtual event_span<ui_event> poll_events() = 0;
+
+        event_span<ui_event> pending_events() { return events_.events(); }
+
+        // Pending events have been handled
+        void consume_events() { events_.clear(); }
+
+        // Input events read so far, before merging
+        uint64_t events_received() { return events_received_; }
+
+        // Events lost because the queue was full
+        uint64_t events_dropped() { return events_.dropped(); }
+
+        // Readable when input arrives, -1 without a connection
+        virtual int connection_fd() { return -1; }
+
+        // Input already read from the connection but not yet polled
+        virtual bool has_queued_events() { return false; }
+
+        // Send pending drawing to the display
+        virtual void present() = 0;
+
+        // Wait until the display has processed all drawing
+        virtual void sync() {}
+
+        // Surface in display server memory, to be filled once and drawn
+        // often (see resident_cache). nullptr if the root surface is local.
+        virtual std::shared_ptr<surface> create_resident_surface(int width, int height, bool opaque) { return nullptr; }
+
+        // Relate display server time to the local clock. Blocks for a few
+        // round trips, call before input is read on other threads.
+        virtual void calibrate_server_time() {}
+
+        // Input event server time (unit: ms) on the local clock (unit: us,
+        // see get_ts()). Zero until calibrated.
+        int64_t server_to_local_ts(uint32_t ts);
+
+        virtual void close() = 0;
+
     protected:
         int width_;
         int height_;
         std::shared_ptr<surface> root_surface_;
+
+        uint64_t events_received_{0};
+        event_queue<ui_event, ui_event_queue_size> events_;
+
+        // Calibration point, see calibrate_server_time()
+        bool server_time_calibrated_{false};
+        uint32_t calibration_server_ts_{0}; // unit: ms
+        int64_t calibration_local_ts_{0};   // unit: us
 };
\ No newline at end of file
@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include <user_interface/button.hpp>
 
 enum class ui_event_type
@@ -40,6 +42,8 @@ enum class ui_event_type
 class ui_event
 {
 public:
+   ui_event() = default;
+
    ui_event(ui_event_type type) : type_(type) {}
   
    ui_event(ui_event_type type, int x, int y)
@@ -60,21 +64,35 @@ public:
    , c_(c)
    {}
 
-   ui_event_type get_type() { return type_;}
-   int get_x() { return x_;}
-   int get_y() { return y_;}
-   char get_c() { return c_;}
-   button get_button_state() { return button_state_; }
+   ui_event_type get_type() const { return type_;}
+   int get_x() const { return x_;}
+   int get_y() const { return y_;}
+   char get_c() const { return c_;}
+   button get_button_state() const { return button_state_; }
+
+   // Local receive time (unit: us, see get_ts())
+   int64_t get_receive_ts() const { return receive_ts_; }
+
+   // X server time (unit: ms, server clock), zero if the event has none
+   uint32_t get_server_ts() const { return server_ts_; }
+
+   void set_c(char c) { c_ = c; }
 
    void set_x(int x) { x_ = x; }
    
    void set_y(int y) { y_ = y; }
 
+   void set_receive_ts(int64_t ts) { receive_ts_ = ts; }
+
+   void set_server_ts(uint32_t ts) { server_ts_ = ts; }
+
 private:
     ui_event_type type_{ui_event_type::none};
     int x_{-1};
     int y_{-1};
     char c_{0};
     button button_state_{button::none};
+    int64_t receive_ts_{0};
+    uint32_t server_ts_{0};
 };
 
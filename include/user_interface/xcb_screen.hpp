@@ -0,0 +1,113 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <xcb/xcb.h>
+#include <cairo.h>
+#include <cairo-xcb.h>
+
+#include <graphics_context/surface.hpp>
+#include <user_interface/screen.hpp>
+#include <user_interface/ui_event.hpp>
+#include <user_interface/button.hpp>
+
+// X11 screen on XCB (cmake -DDINO_MATH_XCB=ON, run with --xcb). Requests
+// are only sent, never waited for, except once at startup where all atoms
+// and the keyboard mapping are fetched in a single round trip. Events are
+// read without blocking; the connection fd drives the frame scheduler.
+class xcb_screen : public screen
+{
+    public:
+        xcb_screen(int width, int height, int xpos, int ypos, std::string title, bool fullscreen);
+
+        ~xcb_screen();
+
+        // Consecutive pointer motion is merged into one event (latest
+        // position, receive time of the first)
+        event_span<ui_event> poll_events() override;
+
+        // X connection, readable when events arrive
+        int connection_fd() override;
+
+        // Events already read from the connection but not yet polled
+        bool has_queued_events() override;
+
+        // Send pending drawing requests to the X server
+        void present() override;
+
+        // Wait until the X server has processed all requests
+        void sync() override;
+
+        // Pixmap with an ARGB32 (opaque: RGB24) XRender format
+        std::shared_ptr<surface> create_resident_surface(int width, int height, bool opaque) override;
+
+        // PropertyNotify round trips
+        void calibrate_server_time() override;
+
+        void close() override;
+
+    private:
+        enum atom
+        {
+            atom_wm_protocols,
+            atom_wm_delete_window,
+            atom_net_wm_state,
+            atom_net_wm_state_fullscreen,
+            atom_dino_math_time,
+            nr_atoms,
+        };
+
+        void handle_event(xcb_generic_event_t* event);
+
+        void set_keymap(xcb_get_keyboard_mapping_reply_t* reply);
+
+        void reload_keymap();
+
+        // Character XLookupString() would give, 0 if none
+        char key_char(xcb_keycode_t keycode, uint16_t state);
+
+        void button_event(button flag, bool pressed);
+
+        xcb_connection_t* connection_{nullptr};
+
+        xcb_window_t window_{0};
+
+        uint32_t event_mask_{0};
+
+        std::array<xcb_atom_t, nr_atoms> atoms_{};
+
+        // Keysyms by keycode, keysyms_per_keycode_ columns each
+        std::vector<xcb_keysym_t> keymap_;
+        xcb_keycode_t min_keycode_{0};
+        int keysyms_per_keycode_{0};
+
+        // Read by has_queued_events(), handled first by poll_events()
+        xcb_generic_event_t* queued_event_{nullptr};
+
+        bool closed_{false};
+
+        button button_state_{button::none};
+};
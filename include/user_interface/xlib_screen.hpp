@@ -42,11 +42,31 @@ class xlib_screen : public screen
 
         ~xlib_screen();
 
-        std::vector<std::shared_ptr<ui_event>> poll_events();
+        // Consecutive pointer motion is merged into one event (latest
+        // position, receive time of the first)
+        event_span<ui_event> poll_events() override;
+
+        // X connection, readable when events arrive
+        int connection_fd() override;
+
+        // Events already read from the connection but not yet polled
+        bool has_queued_events() override;
+
+        // Send pending drawing requests to the X server
+        void present() override;
+
+        // Wait until the X server has processed all requests
+        void sync() override;
+
+        // Pixmap with an ARGB32 (opaque: RGB24) XRender format
+        std::shared_ptr<surface> create_resident_surface(int width, int height, bool opaque) override;
+
+        // PropertyNotify round trips
+        void calibrate_server_time() override;
 
         void button_event(button flag, bool pressed);
 
-        void close();
+        void close() override;
 
     private:
         int xpos_;
@@ -67,6 +87,8 @@ class xlib_screen : public screen
 
         bool closed_{false};
 
+        long event_mask_{0};
+
         button button_state_{button::none};
 };
 
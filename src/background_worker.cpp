@@ -0,0 +1,82 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include <background_worker.hpp>
+#include <profiler.hpp>
+
+background_worker::background_worker()
+{
+    thread_ = std::thread(&background_worker::run, this);
+}
+
+background_worker::~background_worker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_one();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+std::shared_future<void>
+background_worker::post(std::function<void()> job)
+{
+    std::packaged_task<void()> task(std::move(job));
+    auto done = task.get_future().share();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.emplace_back(std::move(task));
+    }
+    cond_.notify_one();
+
+    return done;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+background_worker::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        cond_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            return; // stopped and drained
+        }
+
+        auto task = std::move(jobs_.front());
+        jobs_.pop_front();
+
+        lock.unlock();
+        {
+            PROFILE_ZONE("background_worker::job");
+            task();
+        }
+        lock.lock();
+    }
+}
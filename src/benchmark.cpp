@@ -0,0 +1,510 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <dirent.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#include <benchmark.hpp>
+#include <common.hpp>
+#include <graphics_context/blit.hpp>
+#include <graphics_context/rendering_context.hpp>
+#include <graphics_context/surface.hpp>
+#include <graphics_context/surface_cache.hpp>
+#include <graphics_context/thumbnail_atlas.hpp>
+#include <random_generator.hpp>
+#include <render_thread.hpp>
+#include <user_interface/headless_screen.hpp>
+#include <user_interface/xlib_screen.hpp>
+#ifdef DINO_MATH_XCB
+#include <user_interface/xcb_screen.hpp>
+#endif
+
+constexpr int64_t benchmark_duration = 500000; // unit: us
+
+constexpr const char* dino_image_dir = "/usr/share/dino_math/images/dinosaurs";
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+// Runs fn repeatedly for benchmark_duration. Returns average time per call (unit: us)
+static double measure(std::function<void()> fn)
+{
+    // Warm up
+    fn();
+
+    int64_t iterations = 0;
+    auto start_ts = get_ts();
+    auto now = start_ts;
+    while (now - start_ts < benchmark_duration) {
+        fn();
+        iterations++;
+        now = get_ts();
+    }
+
+    return static_cast<double>(now - start_ts) / static_cast<double>(iterations);
+}
+
+static void print_result(const char* name, double us, double pixels)
+{
+    printf("  %-32s %10.2f us %10.1f Mpixel/s\n", name, us, pixels / us);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+// Sprite sized like a dinosaur on the selection page, with soft edges
+static std::shared_ptr<surface> create_sprite(double width, double height)
+{
+    auto s = std::shared_ptr<surface>(new surface(width, height));
+    s->load_background(0, 0, 0);
+
+    auto cr = s->cr();
+    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+
+    cairo_set_source_rgba(cr, 0.2, 0.6, 0.3, 1.0);
+    cairo_arc(cr, width / 2, height / 2, height / 2.5, 0, 2 * m_pi);
+    cairo_fill(cr);
+
+    cairo_set_source_rgba(cr, 1.0, 0.834, 0.168, 0.5);
+    cairo_rectangle(cr, 0, height / 4, width, height / 4);
+    cairo_fill(cr);
+
+    return s;
+}
+
+static void benchmark_blit()
+{
+    constexpr double dst_width = 1280;
+    constexpr double dst_height = 720;
+    constexpr double sprite_width = 500;
+    constexpr double sprite_height = 250;
+
+    // The window as the render thread sees it, without a display server
+    headless_screen headless(static_cast<int>(dst_width), static_cast<int>(dst_height));
+    auto dst = headless.root_surface();
+    dst->fill(0.1, 0.1, 0.1);
+    auto sprite = create_sprite(sprite_width, sprite_height);
+
+    auto dst_data = cairo_image_surface_get_data(dst->handle());
+    auto dst_stride = cairo_image_surface_get_stride(dst->handle());
+    auto src_data = cairo_image_surface_get_data(sprite->handle());
+    auto src_stride = cairo_image_surface_get_stride(sprite->handle());
+    int w = static_cast<int>(sprite_width);
+    int h = static_cast<int>(sprite_height);
+    double sprite_pixels = sprite_width * sprite_height;
+    double dst_pixels = dst_width * dst_height;
+
+    printf("Blit %dx%d ARGB32 sprite onto %dx%d headless screen\n", w, h,
+           static_cast<int>(dst_width), static_cast<int>(dst_height));
+
+    print_result("cairo paint_with_alpha + paint", measure([&] {
+        cairo_set_source_surface(dst->cr(), sprite->handle(), 10, 10);
+        cairo_paint_with_alpha(dst->cr(), 1.0);
+        cairo_paint(dst->cr());
+    }), sprite_pixels);
+
+    print_result("cairo paint (over)", measure([&] {
+        cairo_set_source_surface(dst->cr(), sprite->handle(), 10, 10);
+        cairo_paint(dst->cr());
+    }), sprite_pixels);
+
+    print_result("cairo paint_with_alpha 0.5", measure([&] {
+        cairo_set_source_surface(dst->cr(), sprite->handle(), 10, 10);
+        cairo_paint_with_alpha(dst->cr(), 0.5);
+    }), sprite_pixels);
+
+    // Opaque sprite, as drawn by surface::draw_surface
+    auto opaque_sprite = std::shared_ptr<surface>(new surface(sprite_width, sprite_height, true));
+    opaque_sprite->load_background(0.2, 0.4, 0.6);
+
+    print_result("cairo RGB24 paint (over)", measure([&] {
+        cairo_set_source_surface(dst->cr(), opaque_sprite->handle(), 10, 10);
+        cairo_paint(dst->cr());
+    }), sprite_pixels);
+
+    print_result("cairo RGB24 rectangle (source)", measure([&] {
+        cairo_set_operator(dst->cr(), CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_surface(dst->cr(), opaque_sprite->handle(), 10, 10);
+        cairo_rectangle(dst->cr(), 10, 10, sprite_width, sprite_height);
+        cairo_fill(dst->cr());
+        cairo_set_operator(dst->cr(), CAIRO_OPERATOR_OVER);
+    }), sprite_pixels);
+
+    print_result("cairo fill (solid)", measure([&] {
+        cairo_set_source_rgb(dst->cr(), 0, 0, 0);
+        cairo_rectangle(dst->cr(), 0, 0, dst_width, dst_height);
+        cairo_fill(dst->cr());
+    }), dst_pixels);
+
+    for (auto isa : { blit_isa::scalar, blit_isa::sse41, blit_isa::avx2, blit_isa::neon }) {
+        auto k = blit_kernels_for(isa);
+        if (k == nullptr) {
+            continue;
+        }
+
+        std::string name = k->name;
+        uint8_t* dst_xy = dst_data + 10 * dst_stride + 10 * 4;
+
+        print_result((name + " copy").c_str(), measure([&] {
+            blit_copy(*k, dst_xy, dst_stride, src_data, src_stride, w, h);
+        }), sprite_pixels);
+
+        print_result((name + " over").c_str(), measure([&] {
+            blit_over(*k, dst_xy, dst_stride, src_data, src_stride, w, h);
+        }), sprite_pixels);
+
+        print_result((name + " over_alpha 0.5").c_str(), measure([&] {
+            blit_over_alpha(*k, dst_xy, dst_stride, src_data, src_stride, w, h, 128);
+        }), sprite_pixels);
+
+        print_result((name + " fill").c_str(), measure([&] {
+            blit_fill(*k, dst_data, dst_stride, static_cast<int>(dst_width), static_cast<int>(dst_height), 0xff000000);
+        }), dst_pixels);
+    }
+
+    printf("Selected kernels: %s\n", blit_best_kernels().name);
+
+    headless.close();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+// Whole frames as the game draws them, on a headless_screen: recorded
+// through rendering_context on this thread, replayed and presented by the
+// render thread. Back pressure of the render queue is included, so a
+// result is the cost of the slower of the two.
+static void benchmark_frame()
+{
+    constexpr int screen_width = 1280;
+    constexpr int screen_height = 720;
+    constexpr double sprite_width = 250; // reference units, selection page
+    constexpr double sprite_height = 125;
+    constexpr int nr_sprites = 4;
+
+    auto headless = std::make_shared<headless_screen>(screen_width, screen_height);
+    auto ctx = std::make_shared<rendering_context>(headless, ref_width, ref_height, anti_aliasing::best);
+    ctx->font_face("Lato Black", font_slant::normal, font_weight::normal);
+
+    auto sprite = create_sprite(ctx->scale(sprite_width), ctx->scale(sprite_height));
+    sprite->set_immutable();
+
+    auto renderer = std::make_shared<render_thread>(headless);
+
+    auto frame = [&](std::function<void()> draw) {
+        return measure([&] {
+            frame_snapshot snapshot;
+            std::unique_lock<std::mutex> lock(renderer->cairo_mutex());
+            ctx->begin_frame();
+            draw();
+            snapshot.recording = ctx->end_frame();
+            lock.unlock();
+            renderer->submit(std::move(snapshot));
+        });
+    };
+
+    printf("Frames on a %dx%d headless screen (unit: us per frame)\n", screen_width, screen_height);
+
+    printf("  %-32s %10.2f\n", "empty", frame([] {}));
+
+    printf("  %-32s %10.2f\n", "full screen fill", frame([&] {
+        ctx->set_source_rgb(0.1, 0.1, 0.1);
+        ctx->rectangle(0, 0, ref_width, ref_height);
+        ctx->fill();
+    }));
+
+    printf("  %-32s %10.2f\n", "one sprite (hover)", frame([&] {
+        ctx->set_source_rgb(0, 0, 0);
+        ctx->rectangle(100, 100, sprite_width, sprite_height);
+        ctx->fill();
+        ctx->draw_surface(sprite, 100, 100, 1.0);
+    }));
+
+    printf("  %-32s %10.2f\n", "selection page", frame([&] {
+        ctx->set_source_rgb(0, 0, 0);
+        ctx->rectangle(0, 0, ref_width, ref_height);
+        ctx->fill();
+        ctx->font_size(25);
+        for(int i = 0; i < nr_sprites; i++) {
+            double x = 50 + (i % 2) * 600;
+            double y = 100 + (i / 2) * 280;
+            ctx->draw_surface(sprite, x, y, 1.0);
+            ctx->set_source_rgb(1.0, 0.834, 0.168);
+            ctx->move_to(x, y + sprite_height + 20);
+            ctx->show_text("Tyrannosaurus");
+        }
+    }));
+
+    renderer->stop();
+    printf("  %lu frames presented\n", static_cast<unsigned long>(headless->frames()));
+    renderer->print_stats();
+
+    headless->close();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+static std::vector<std::string> installed_dino_paths()
+{
+    std::vector<std::string> paths;
+
+    auto dir = opendir(dino_image_dir);
+    if (dir == nullptr) {
+        return paths;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.substr(name.size() - 4) == ".svg") {
+            paths.emplace_back(std::string(dino_image_dir) + "/" + name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// Time to build one 600x300 gameplay collage for a range of dino counts
+static void benchmark_collage()
+{
+    constexpr double collage_width = 600;
+    constexpr double collage_height = 300;
+
+    auto svg_paths = installed_dino_paths();
+    if (svg_paths.empty()) {
+        printf("No dinosaurs found in %s\n", dino_image_dir);
+        return;
+    }
+
+    auto sur_cache = std::make_shared<surface_cache>(static_cast<int>(ref_width), static_cast<int>(ref_height));
+    int nr_threads = std::max(1, std::min(4, static_cast<int>(std::thread::hardware_concurrency())));
+
+    std::vector<int> counts = { 1, 2, 4, 8, 16, 32, 64, 100, 150, 200, 250, 300, 400, 500, 600 };
+
+    std::vector<std::string> lines;
+    for (auto nr_dinos : counts) {
+        int nr_cols = std::max(2, static_cast<int>(ceil(sqrt(static_cast<double>(nr_dinos)))));
+        int nr_rows = static_cast<int>(ceil(static_cast<double>(nr_dinos) / nr_cols));
+        double thumbnail_width = floor(collage_width / nr_cols);
+        double thumbnail_height = floor(thumbnail_width / (collage_width / collage_height));
+
+        random_generator rng(nr_dinos);
+        std::vector<int> indices;
+        for (int i = 0; i < nr_dinos; i++) {
+            indices.emplace_back(rng.uniform(0, static_cast<int>(svg_paths.size()) - 1));
+        }
+
+        std::vector<std::shared_ptr<surface>> thumbnails;
+        for (auto&& path : svg_paths) {
+            thumbnails.emplace_back(sur_cache->get_svg_surface(path, thumbnail_width, thumbnail_height));
+        }
+
+        auto collage = std::shared_ptr<surface>(new surface(collage_width, collage_height));
+        collage->load_background(0, 0, 0);
+
+        // One draw_surface per thumbnail
+        double per_thumbnail = measure([&] {
+            collage->fill(0, 0, 0);
+            for (int i = 0; i < nr_dinos; i++) {
+                collage->draw_surface(thumbnails[indices[i]],
+                                      (i % nr_cols) * thumbnail_width,
+                                      (i / nr_cols) * thumbnail_height,
+                                      1.0);
+            }
+        });
+
+        auto atlas_build_ts = get_ts();
+        thumbnail_atlas atlas(sur_cache, svg_paths, static_cast<int>(thumbnail_width), static_cast<int>(thumbnail_height));
+        auto atlas_build_time = get_ts() - atlas_build_ts;
+
+        double atlas_serial = measure([&] {
+            collage->fill(0, 0, 0);
+            atlas.compose(collage, indices, nr_cols, 1);
+        });
+
+        double atlas_parallel = measure([&] {
+            collage->fill(0, 0, 0);
+            atlas.compose(collage, indices, nr_cols, nr_threads);
+        });
+
+        char line[200];
+        snprintf(line, sizeof(line), "  %5d %4dx%-4d %12.1f %12.1f %12.1f %12ld",
+                 nr_dinos, nr_cols, nr_rows, per_thumbnail, atlas_serial, atlas_parallel,
+                 static_cast<long>(atlas_build_time));
+        lines.emplace_back(line);
+    }
+
+    printf("Collage %dx%d, %zu dinos selected, %d fill threads (unit: us per collage)\n",
+           static_cast<int>(collage_width), static_cast<int>(collage_height), svg_paths.size(), nr_threads);
+    printf("  %5s %9s %12s %12s %12s %12s\n", "dinos", "grid", "per-thumb", "atlas", "atlas-mt", "atlas-build");
+    for (auto&& line : lines) {
+        printf("%s\n", line.c_str());
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+// Picking the dino of every collage cell: one std::random_device per cell
+// (original code), std::mt19937 per collage and the game generator
+static void benchmark_random()
+{
+    constexpr int nr_dinos = 600; // largest collage
+    constexpr int nr_selected = 34;
+
+    std::vector<int> indices(nr_dinos);
+    uint32_t seed = 0;
+
+    double device = measure([&] {
+        for (int i = 0; i < nr_dinos; i++) {
+            std::random_device rd;
+            std::uniform_int_distribution<int> dist(0, nr_selected - 1);
+            indices[i] = dist(rd);
+        }
+    });
+
+    double mt19937 = measure([&] {
+        std::mt19937 rng(seed++);
+        std::uniform_int_distribution<int> dist(0, nr_selected - 1);
+        for (int i = 0; i < nr_dinos; i++) {
+            indices[i] = dist(rng);
+        }
+    });
+
+    double xoshiro = measure([&] {
+        random_generator rng(seed++);
+        for (int i = 0; i < nr_dinos; i++) {
+            indices[i] = rng.uniform(0, nr_selected - 1);
+        }
+    });
+
+    printf("Collage cell picks, %d cells (unit: us per collage)\n", nr_dinos);
+    printf("  %-32s %10.2f\n", "std::random_device per cell", device);
+    printf("  %-32s %10.2f\n", "std::mt19937 per collage", mt19937);
+    printf("  %-32s %10.2f\n", "xoshiro256** per collage", xoshiro);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+constexpr int screen_startups = 10;
+
+// Startup counts until the server has processed the window setup
+static void benchmark_screen_backend(const char* name, std::function<std::shared_ptr<screen>()> create)
+{
+    int64_t startup = 0;
+    for(int i = 0; i < screen_startups; i++) {
+        auto start_ts = get_ts();
+        auto s = create();
+        s->sync();
+        startup += get_ts() - start_ts;
+        s->close();
+    }
+
+    auto s = create();
+    s->sync();
+
+    auto round_trip = measure([&] {
+        s->sync();
+    });
+
+    auto poll = measure([&] {
+        s->poll_events();
+        s->consume_events();
+    });
+
+    s->close();
+
+    printf("  %-8s %12.1f %12.2f %12.3f\n", name,
+           static_cast<double>(startup) / screen_startups, round_trip, poll);
+}
+
+static void benchmark_screen()
+{
+    printf("Screen backends (unit: us)\n");
+    printf("  %-8s %12s %12s %12s\n", "", "startup", "round trip", "empty poll");
+
+    benchmark_screen_backend("headless", [] {
+        return std::shared_ptr<screen>(new headless_screen(640, 360));
+    });
+
+    if (getenv("DISPLAY") == nullptr) {
+        printf("  X backends need an X display, e.g. Xvfb :99 & DISPLAY=:99 dino_math --benchmark=screen\n");
+        return;
+    }
+
+    benchmark_screen_backend("xlib", [] {
+        return std::shared_ptr<screen>(new xlib_screen(640, 360, 0, 0, "Dino Math benchmark", false));
+    });
+
+#ifdef DINO_MATH_XCB
+    benchmark_screen_backend("xcb", [] {
+        return std::shared_ptr<screen>(new xcb_screen(640, 360, 0, 0, "Dino Math benchmark", false));
+    });
+#else
+    printf("  %-8s not built (cmake -DDINO_MATH_XCB=ON)\n", "xcb");
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+struct benchmark_entry
+{
+    std::string name;
+    std::function<void()> fn;
+};
+
+static std::vector<benchmark_entry> benchmarks()
+{
+    return {
+        { "blit", benchmark_blit },
+        { "collage", benchmark_collage },
+        { "frame", benchmark_frame },
+        { "random", benchmark_random },
+        { "screen", benchmark_screen },
+    };
+}
+
+std::vector<std::string> benchmark_names()
+{
+    std::vector<std::string> names;
+    for (auto&& b : benchmarks()) {
+        names.emplace_back(b.name);
+    }
+    return names;
+}
+
+bool run_benchmark(std::string name)
+{
+    for (auto&& b : benchmarks()) {
+        if (b.name == name) {
+            b.fn();
+            return true;
+        }
+    }
+
+    return false;
+}
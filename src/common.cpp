@@ -18,6 +18,7 @@
  */
 
 #include <common.hpp>
+#include <algorithm>
 #include <chrono>
 
 int64_t get_ts()
@@ -26,3 +27,42 @@ int64_t get_ts()
     return static_cast<int64_t>(std::chrono::time_point_cast<std::chrono::microseconds>(now).time_since_epoch().count());
 }
 
+int64_t get_ts_ns()
+{
+    auto now = std::chrono::steady_clock::now();
+    return static_cast<int64_t>(std::chrono::time_point_cast<std::chrono::nanoseconds>(now).time_since_epoch().count());
+}
+
+static int64_t game_ts = 0;
+
+int64_t get_game_ts()
+{
+    return game_ts != 0 ? game_ts : get_ts();
+}
+
+void set_game_ts(int64_t ts)
+{
+    game_ts = ts;
+}
+
+bool overlaps(const rect& a, const rect& b)
+{
+    return a.x < b.x + b.width && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+rect united(const rect& a, const rect& b)
+{
+    if (a.width <= 0 || a.height <= 0) {
+        return b;
+    }
+    if (b.width <= 0 || b.height <= 0) {
+        return a;
+    }
+
+    auto x = std::min(a.x, b.x);
+    auto y = std::min(a.y, b.y);
+    return { x, y,
+             std::max(a.x + a.width, b.x + b.width) - x,
+             std::max(a.y + a.height, b.y + b.height) - y };
+}
@@ -18,23 +18,32 @@
  */
 
 #include <chrono>
-#include <iomanip>
+#include <random>
 #include <iostream>
-#include <sstream>
 #include <stdlib.h>
-#include <timer.hpp>
 #include <unistd.h>
 
 #include <dino_math.hpp>
+#include <frame_scheduler.hpp>
+#include <profiler.hpp>
+#include <user_interface/headless_screen.hpp>
+#include <user_interface/xlib_screen.hpp>
+#ifdef DINO_MATH_XCB
+#include <user_interface/xcb_screen.hpp>
+#endif
 #include <scene/00_cache_generation_scene/cache_generation_scene.hpp>
 #include <scene/01_splash_screen/splash_screen_scene.hpp>
 #include <scene/02_dino_selection/dino_selection_scene.hpp>
 #include <scene/04_gameplay/gameplay_scene.hpp>
 
-dino_math::dino_math(int screen_width, int screen_height, bool fullscreen)
+// Chrome trace output of builds with DINO_MATH_PROFILER
+constexpr const char* profiler_trace_path = "/tmp/dino_math_trace.json";
+
+dino_math::dino_math(int screen_width, int screen_height, bool fullscreen, bool latency_mode)
  : screen_width_(screen_width)
  , screen_height_(screen_height)
  , fullscreen_(fullscreen)
+ , latency_mode_(latency_mode)
 {
     target_fps_ = 120;
     current_fps_ = target_fps_;
@@ -45,14 +54,14 @@ dino_math::dino_math(int screen_width, int screen_height, bool fullscreen)
 void dino_math::scene_init()
 {
     scene_idx_++;
-    scenes_[scene_idx_++] = std::make_shared<splash_screen_scene>(splash_screen_scene(ctx_, sur_cache_));
+    scenes_[scene_idx_++] = std::make_shared<splash_screen_scene>(ctx_, sur_cache_);
 
-    auto selection = std::make_shared<dino_selection_scene>(dino_selection_scene(ctx_, sur_cache_));
+    auto selection = std::make_shared<dino_selection_scene>(ctx_, sur_cache_);
     scenes_[scene_idx_++] = selection;
 
     auto all_svg_paths = selection->get_all_svg_paths();
     
-    auto gameplay = std::make_shared<gameplay_scene>(gameplay_scene(ctx_, sur_cache_));
+    auto gameplay = std::make_shared<gameplay_scene>(ctx_, sur_cache_, rng_);
     scenes_[scene_idx_++] = gameplay;
     
     gameplay->simulate_gameplay(all_svg_paths);
@@ -60,28 +69,66 @@ void dino_math::scene_init()
     scene_idx_ = 0;
     scenes_[scene_idx_]->end();
     scenes_[scene_idx_]->invalidate();
+    scheduler_->request_frame();
 }
 
-bool dino_math::check_ui_events()
+void dino_math::poll_ui_events()
 {
-    bool scene_updated = false;
+    auto nr_pending = screen_->pending_events().size();
     auto events = screen_->poll_events();
-    for(auto&& event : events) {
-        switch (event->get_type()) {
+    if (events.size() == nr_pending) {
+        return;
+    }
+
+    input_events_polled_ += events.size() - nr_pending;
+
+    // Handled on the next frame
+    scheduler_->request_frame();
+}
+
+void dino_math::check_ui_events(frame_snapshot& frame)
+{
+    PROFILE_ZONE("dino_math::check_ui_events");
+
+    auto events = screen_->pending_events();
+
+    // Only the latest pointer position of the frame is dispatched. Button
+    // presses carry their own position and are always kept.
+    size_t last_pointer_event = 0;
+    int64_t first_motion_ts = 0;
+    for(size_t i = 0; i < events.size(); i++) {
+        auto type = events[i].get_type();
+        if (type == ui_event_type::pointer_motion || type == ui_event_type::button_press) {
+            last_pointer_event = i;
+        }
+        if (type == ui_event_type::pointer_motion && first_motion_ts == 0) {
+            first_motion_ts = events[i].get_receive_ts();
+        }
+    }
+
+    for(size_t i = 0; i < events.size(); i++) {
+        auto& event = events[i];
+        if (event.get_type() == ui_event_type::pointer_motion) {
+            if (i < last_pointer_event) {
+                continue;
+            }
+            event.set_receive_ts(first_motion_ts);
+        }
+        input_events_dispatched_++;
+
+        switch (event.get_type()) {
             case ui_event_type::expose: {
+                // Repainted by draw_scene() at the end of the frame
                 scenes_[scene_idx_]->invalidate();
-                draw_scene();
-                scene_updated = true;
 
                 if (!initial_expose_event_) {
                   scene_init();
-                  scene_updated = false;
                   initial_expose_event_ = true;
                 }
                 break;
             }
             case ui_event_type::key_press: {
-                auto c = event->get_c();
+                auto c = event.get_c();
 
                 printf("c %d\n", c);
 
@@ -90,30 +137,71 @@ bool dino_math::check_ui_events()
                 }
                 else if (c == 96) {
                     osd_ = !osd_;
+                    if (overlay_ == nullptr) {
+                        overlay_ = std::make_shared<on_screen_display>(ctx_);
+                    }
                     clear_on_screen_display();
-                    draw_scene();
-                    scene_updated = true;
+                    if (!osd_) {
+                        // Repaint what the overlay covered
+                        scenes_[scene_idx_]->invalidate({ 0, 0, overlay_->width(), overlay_->height() });
+                    }
+                    scheduler_->request_frame();
                 } else {
-                    draw_scene(*event);
+                    auto dispatch_ts = latency_mode_ ? get_ts() : 0;
+                    draw_scene(event);
+                    input_scene_draws_++;
+                    add_latency_sample(frame, event, dispatch_ts);
                 }
 
+                if (frame.earliest_input_ts == 0) {
+                    frame.earliest_input_ts = event.get_receive_ts();
+                }
+                frame.input_ts_sum += event.get_receive_ts();
+                frame.nr_input_events++;
+                break;
+            }
+            case ui_event_type::close: { // window manager close button
+                exit_ = true;
                 break;
             }
             case ui_event_type::pointer_motion:
             case ui_event_type::button_press: {
                 // Update mouse coordinates (inverted scaling)
-                event->set_x(ctx_->iscale(event->get_x()));
-                event->set_y(ctx_->iscale(event->get_y()));
+                event.set_x(ctx_->iscale(event.get_x()));
+                event.set_y(ctx_->iscale(event.get_y()));
+
+                auto dispatch_ts = latency_mode_ ? get_ts() : 0;
+                draw_scene(event);
+                input_scene_draws_++;
+                if (event.get_type() == ui_event_type::button_press) {
+                    add_latency_sample(frame, event, dispatch_ts);
+                }
 
-                draw_scene(*event);
+                if (frame.earliest_input_ts == 0) {
+                    frame.earliest_input_ts = event.get_receive_ts();
+                }
+                frame.input_ts_sum += event.get_receive_ts();
+                frame.nr_input_events++;
                 break;
             }
             default:
                 break;
         }
     } // end of events loop
+    screen_->consume_events();
+}
 
-    return scene_updated;
+void dino_math::add_latency_sample(frame_snapshot& frame, const ui_event& event, int64_t dispatch_ts)
+{
+    if (!latency_mode_ || frame.nr_latency_samples == frame.latency_samples.size()) {
+        return;
+    }
+
+    auto& sample = frame.latency_samples[frame.nr_latency_samples++];
+    sample.server_ts = screen_->server_to_local_ts(event.get_server_ts());
+    sample.receive_ts = event.get_receive_ts();
+    sample.dispatch_ts = dispatch_ts;
+    sample.drawn_ts = get_ts();
 }
 
 void dino_math::draw_scene()
@@ -136,6 +224,7 @@ void dino_math::draw_scene()
         }
     } 
 
+    PROFILE_ZONE(scene->name());
     scene->draw();
 
     // On screen display (debug)
@@ -144,73 +233,49 @@ void dino_math::draw_scene()
     }
 }
 
-void dino_math::draw_scene(ui_event ev)
+void dino_math::draw_scene(const ui_event& ev)
 {
     auto scene = scenes_[scene_idx_];
-    scene->draw(ev);
 
-    // On screen display (debug)
-    if (osd_) {
-        draw_on_screen_display();
-    }
+    PROFILE_ZONE(scene->name());
+    scene->draw(ev);
 }
 
-std::string dino_math::elapsed_time_str(int64_t elapsed_time) {
-    elapsed_time /= 1000000; // to seconds
-
-    auto days = elapsed_time / (3600 * 24);
-    elapsed_time -= days * (3600 * 24);
-    
-    auto hours = elapsed_time / 3600;
-    elapsed_time -= hours * (3600);
-
-    auto minutes = elapsed_time / 60;
-    auto seconds = elapsed_time % 60;
-
-    std::ostringstream oss;
-    oss << std::setfill('0');
-    oss << std::setw(3);
-    oss << days << ":";
-    oss << std::setw(2);
-    oss << hours << ":";
-    oss << std::setw(2);
-    oss << minutes << ":";
-    oss << std::setw(2);
-    oss << seconds;
-
-    return oss.str();
+void dino_math::record_frame_time(int64_t frame_time)
+{
+    scenes_[scene_idx_]->frame_times().add(frame_time);
+    if (overlay_ != nullptr) {
+        overlay_->add_frame_time(frame_time);
+    }
 }
 
 void dino_math::clear_on_screen_display()
 {
     ctx_->set_source_rgb(0, 0, 0);
-    ctx_->rectangle(0,0, 500, 40);
+    ctx_->rectangle(0, 0, overlay_->width(), overlay_->height());
     ctx_->fill();
 }
 
 void dino_math::draw_on_screen_display()
 {
-    auto elapsed_time = get_ts() - start_ts_;
-    auto elapsed_str = elapsed_time_str(elapsed_time);
-
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(0);
-    oss << "FPS: " << static_cast<int>(current_fps_);
-    oss << ", elapsed time: " << elapsed_str;
-
-    ctx_->set_source_rgb(0, 0, 0);
-    ctx_->rectangle(0,0, 500, 30);
-    ctx_->fill();
-
-    ctx_->set_source_rgb(1.0, 0.834, 0.168);
-    ctx_->move_to(10,25);
-    ctx_->font_size(25);
-    ctx_->show_text(oss.str());
+    osd_values values;
+    values.fps = current_fps_;
+    values.target_fps = target_fps_;
+    values.elapsed_time = get_ts() - start_ts_;
+    values.frame_times = &scenes_[scene_idx_]->frame_times();
+    values.cache_stats = sur_cache_->stats();
+    values.visits = object::visit_count();
+    values.redraws = object::redraw_count();
+    values.overlaps = object::overlap_count();
+
+    overlay_->draw(values);
 }
 
-void dino_math::run()
+void dino_math::init(uint64_t seed)
 {
-    screen_ = std::shared_ptr<xlib_screen>(new xlib_screen(screen_width_, screen_height_, 0, 0, "Dino Math", fullscreen_));
+    // All game randomness derives from the seed
+    seed_ = seed;
+    rng_ = std::make_shared<random_generator>(seed_);
 
     ctx_ = std::make_shared<rendering_context>(rendering_context(screen_,
                           ref_width,
@@ -219,52 +284,240 @@ void dino_math::run()
 
     ctx_->font_face("Lato Black", font_slant::normal, font_weight::normal);
 
-    sur_cache_ = std::make_shared<surface_cache>(surface_cache(screen_width_, screen_height_));
+    sur_cache_ = std::make_shared<surface_cache>(screen_width_, screen_height_);
+
+    // Recorded and replayed runs render every sprite from its SVG, so
+    // frame digests do not depend on the state of the persistent cache
+    if (replaying_ || !record_path_.empty()) {
+        sur_cache_->set_persistent_cache(false);
+    }
 
     // Display splash screen while loading background
-    scenes_[scene_idx_] = std::make_shared<cache_generation_scene>(cache_generation_scene(ctx_, sur_cache_));
+    scenes_[scene_idx_] = std::make_shared<cache_generation_scene>(ctx_, sur_cache_);
     scene_idx_ = 0;
 
-    auto screen_update_timer = timer();
-    double period = 1000.0 / target_fps_;
-    auto timer_id = screen_update_timer.register_one_shot_timer(std::chrono::milliseconds(static_cast<int>(period)));
+    // Frames are only drawn on request. Input, scene deadlines and
+    // notifications wake the loop, a static screen sleeps.
+    scheduler_ = std::make_shared<frame_scheduler>(target_fps_);
+    if (screen_->connection_fd() >= 0) {
+        scheduler_->watch_input(screen_->connection_fd());
+    }
+
+    // Rasterizes and presents the recorded frames
+    renderer_ = std::make_shared<render_thread>(screen_);
+    renderer_->set_latency_mode(latency_mode_);
+}
 
-    while(!exit_) {
-        auto events = screen_update_timer.wait_for_events();
-        for(auto&& event : events) {
-            if (event->id() != timer_id) {
-                continue;
+void dino_math::draw_frame()
+{
+    PROFILE_ZONE("frame");
+    auto ts1 = get_ts();
+
+    // Input of the whole frame, then one draw. Scene transitions and
+    // time driven updates run every frame, also while input keeps coming.
+    // Recorded here, put on screen by the render thread.
+    frame_snapshot frame;
+    std::unique_lock<std::mutex> lock(renderer_->cairo_mutex());
+    ctx_->begin_frame();
+    object::reset_redraw_count();
+    poll_ui_events();
+    if (recorder_ != nullptr) {
+        recorder_->write_frame(get_game_ts(), screen_->pending_events());
+    }
+    check_ui_events(frame);
+    draw_scene();
+    frame.recording = ctx_->end_frame();
+    lock.unlock();
+    renderer_->submit(std::move(frame));
+
+    auto ts2 = get_ts();
+    auto diff = ts2 - ts1;
+    record_frame_time(diff);
+
+    double expected_period = 1000000.0 / current_fps_;
+    if (diff > expected_period * 1.1) {
+        current_fps_ /= diff / expected_period;
+            if (current_fps_ < 1) {
+                current_fps_ = 1;
             }
-            auto ts1 = get_ts();
+        } else {
+            if (current_fps_ < target_fps_) {
+                current_fps_ *= expected_period / diff;
+            }
+            if (current_fps_ > target_fps_) {
+                current_fps_ = target_fps_;
+            }
+    }
+    scheduler_->set_fps(current_fps_);
+}
 
-            auto scene_updated = check_ui_events();
-            if (!scene_updated) {
-                draw_scene();
+void dino_math::run()
+{
+#ifdef DINO_MATH_XCB
+    if (xcb_) {
+        screen_ = std::shared_ptr<screen>(new xcb_screen(screen_width_, screen_height_, 0, 0, "Dino Math", fullscreen_));
+    } else
+#endif
+    screen_ = std::shared_ptr<screen>(new xlib_screen(screen_width_, screen_height_, 0, 0, "Dino Math", fullscreen_));
+    if (latency_mode_) {
+        screen_->calibrate_server_time();
+    }
+
+    if (!seed_set_) {
+        std::random_device rd;
+        seed_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+    printf("Seed: %llu\n", static_cast<unsigned long long>(seed_));
+    init(seed_);
+
+    if (!record_path_.empty()) {
+        recorder_ = std::make_shared<input_log_writer>();
+        if (!recorder_->open(record_path_, seed_, screen_width_, screen_height_, start_ts_)) {
+            recorder_ = nullptr;
+        }
+    }
+
+    while(!exit_) {
+        // Already queued by Xlib, the connection fd will not signal these
+        if (screen_->has_queued_events()) {
+            poll_ui_events();
+            continue;
+        }
+
+        auto scene = scenes_[scene_idx_];
+        if (scene->ended() || osd_) {
+            // Scene transition or ticking OSD
+            scheduler_->request_frame();
+        }
+        scheduler_->set_deadline(scene->next_deadline());
+
+        auto wakeup = scheduler_->wait();
+        if (wakeup.input) {
+            poll_ui_events();
+        }
+
+        if (wakeup.deadline || wakeup.notify) {
+            scheduler_->request_frame();
+        }
+
+        if (!wakeup.frame || exit_) {
+            continue;
+        }
+
+        set_game_ts(get_ts());
+        draw_frame();
+    }
+
+    if (recorder_ != nullptr) {
+        recorder_->close();
+    }
+
+    finish();
+}
+
+bool dino_math::replay(const std::string& path, bool unthrottled, const std::string& digests_path)
+{
+    input_log_reader log;
+    if (!log.open(path)) {
+        return false;
+    }
+
+    screen_width_ = log.width();
+    screen_height_ = log.height();
+    screen_ = std::make_shared<headless_screen>(screen_width_, screen_height_);
+    replaying_ = true;
+    auto headless = std::static_pointer_cast<headless_screen>(screen_);
+    headless->set_frame_dump(frame_dump_dir_);
+
+    init(log.seed());
+    renderer_->set_frame_digests(true);
+
+    // The recorded session starts now
+    start_ts_ = get_ts();
+
+    int64_t ts;
+    std::vector<ui_event> events;
+    while(!exit_ && log.read_frame(ts, events)) {
+        if (!unthrottled) {
+            auto delay = start_ts_ + ts - get_ts();
+            if (delay > 0) {
+                usleep(static_cast<useconds_t>(delay));
             }
+        }
 
-            auto ts2 = get_ts();
-            auto diff = ts2 - ts1;
+        for(auto&& event : events) {
+            event.set_receive_ts(start_ts_ + event.get_receive_ts());
+            headless->push_event(event);
+        }
 
-            double expected_period = 1000000.0 / current_fps_;
-            if (diff > expected_period * 1.1) {
-                current_fps_ /= diff / expected_period;
-                    if (current_fps_ < 1) {
-                        current_fps_ = 1;
-                    }
-                } else {
-                    if (current_fps_ < target_fps_) {
-                        current_fps_ *= expected_period / diff;
-                    }
-                    if (current_fps_ > target_fps_) {
-                        current_fps_ = target_fps_;
-                    }
+        set_game_ts(start_ts_ + ts);
+        draw_frame();
+    }
+
+    renderer_->stop();
+
+    // Identical input and seed give identical frames
+    auto& digests = renderer_->frame_digests();
+    uint64_t digest = 0xcbf29ce484222325ULL;
+    for(auto d : digests) {
+        digest = (digest ^ d) * 0x100000001b3ULL;
+    }
+    printf("Replay: %zu frames (%s), digest %016llx\n", digests.size(),
+           unthrottled ? "unthrottled" : "real time",
+           static_cast<unsigned long long>(digest));
+
+    if (!frame_dump_dir_.empty()) {
+        printf("Replay: %lu frames written to %s\n",
+               static_cast<unsigned long>(headless->frames()), frame_dump_dir_.c_str());
+    }
+
+    if (!digests_path.empty()) {
+        auto f = fopen(digests_path.c_str(), "w");
+        if (f == nullptr) {
+            perror(digests_path.c_str());
+        } else {
+            for(size_t i = 0; i < digests.size(); i++) {
+                fprintf(f, "%zu %016llx\n", i, static_cast<unsigned long long>(digests[i]));
             }
+            fclose(f);
+        }
+    }
+
+    finish();
+    return true;
+}
+
+void dino_math::finish()
+{
+    renderer_->stop();
+
+    printf("Input: %lu events received, %lu after merging motion, %lu dispatched, %lu scene draws, %lu dropped\n",
+           static_cast<unsigned long>(screen_->events_received()),
+           static_cast<unsigned long>(input_events_polled_),
+           static_cast<unsigned long>(input_events_dispatched_),
+           static_cast<unsigned long>(input_scene_draws_),
+           static_cast<unsigned long>(screen_->events_dropped()));
 
-            period = 1000.0 / current_fps_;
-            timer_id = screen_update_timer.register_one_shot_timer(std::chrono::milliseconds(static_cast<int>(period)));
+    renderer_->print_stats();
+
+    ctx_->print_stats();
+
+    scheduler_->print_stats();
+
+    printf("Frame times:\n");
+    for(auto&& s : scenes_) {
+        auto& frame_times = s.second->frame_times();
+        if (frame_times.count() > 0) {
+            printf("  %-16s %6lu frames, %s\n", s.second->name(),
+                   static_cast<unsigned long>(frame_times.count()), frame_times.summary().c_str());
         }
     }
 
+    for(auto&& s : scenes_) {
+        s.second->print_statistics();
+    }
+
+    profiler_write_trace(profiler_trace_path);
+
     screen_->close();
 }
-
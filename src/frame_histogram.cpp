@@ -0,0 +1,107 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <algorithm>
+#include <stdio.h>
+
+#include <frame_histogram.hpp>
+
+int frame_histogram::bucket_index(int64_t value)
+{
+    if (value < linear_limit) {
+        return static_cast<int>(std::max<int64_t>(value, 0));
+    }
+
+    int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+    if (exponent >= max_exponent) {
+        return nr_buckets - 1;
+    }
+
+    int sub_bucket = static_cast<int>(value >> (exponent - sub_bucket_bits)) & ((1 << sub_bucket_bits) - 1);
+    return linear_limit + (exponent - 6) * (1 << sub_bucket_bits) + sub_bucket;
+}
+
+int64_t frame_histogram::bucket_upper_bound(int index)
+{
+    if (index < linear_limit) {
+        return index;
+    }
+
+    int exponent = (index - linear_limit) / (1 << sub_bucket_bits) + 6;
+    int64_t sub_bucket = (index - linear_limit) % (1 << sub_bucket_bits);
+    int64_t width = int64_t(1) << (exponent - sub_bucket_bits);
+    return (((int64_t(1) << sub_bucket_bits) + sub_bucket) << (exponent - sub_bucket_bits)) + width - 1;
+}
+
+void frame_histogram::add(int64_t value)
+{
+    buckets_[bucket_index(value)]++;
+    count_++;
+    sum_ += value;
+    max_ = std::max(max_, value);
+}
+
+void frame_histogram::reset()
+{
+    buckets_.fill(0);
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+}
+
+double frame_histogram::mean()
+{
+    if (count_ == 0) {
+        return 0;
+    }
+
+    return static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+int64_t frame_histogram::percentile(double p)
+{
+    if (count_ == 0) {
+        return 0;
+    }
+
+    auto rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count_) + 0.5);
+    rank = std::max<uint64_t>(1, std::min(rank, count_));
+
+    uint64_t seen = 0;
+    for(int i = 0; i < nr_buckets; i++) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            // The bucket bound may overshoot the largest sample
+            return std::min(bucket_upper_bound(i), max_);
+        }
+    }
+
+    return max_;
+}
+
+std::string frame_histogram::summary()
+{
+    char str[100];
+    snprintf(str, sizeof(str), "p50 %.2f p95 %.2f p99 %.2f max %.2f ms",
+             static_cast<double>(percentile(50)) / 1000.0,
+             static_cast<double>(percentile(95)) / 1000.0,
+             static_cast<double>(percentile(99)) / 1000.0,
+             static_cast<double>(max_) / 1000.0);
+    return str;
+}
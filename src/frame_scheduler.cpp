@@ -0,0 +1,222 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <cmath>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#include <common.hpp>
+#include <frame_scheduler.hpp>
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+frame_scheduler::frame_scheduler(double fps)
+{
+    created_ts_ = get_ts();
+
+    frame_timer_id_ = timer_.register_timer();
+    deadline_timer_id_ = timer_.register_timer();
+
+    notify_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    notify_id_ = timer_.register_fd(notify_fd_);
+
+    set_fps(fps);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+frame_scheduler::~frame_scheduler()
+{
+    close(notify_fd_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+frame_scheduler::watch_input(int fd)
+{
+    input_id_ = timer_.register_fd(fd);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+frame_scheduler::request_frame()
+{
+    frame_requested_ = true;
+    end_idle();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+frame_scheduler::set_deadline(int64_t ts)
+{
+    if (ts == deadline_) {
+        return;
+    }
+    deadline_ = ts;
+
+    if (ts == 0) {
+        timer_.disarm(deadline_timer_id_);
+        return;
+    }
+
+    timer_.arm_at(deadline_timer_id_, std::chrono::microseconds(ts));
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+frame_scheduler::set_fps(double fps)
+{
+    // Applies from the next frame deadline on
+    frame_period_ = std::chrono::nanoseconds(llround(1000000000.0 / fps));
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+frame_scheduler::notify()
+{
+    uint64_t value = 1;
+    if (write(notify_fd_, &value, sizeof(value)) != sizeof(value)) {
+        perror("eventfd write");
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+frame_wakeup
+frame_scheduler::wait()
+{
+    // Only tick while frames are wanted. Stay on the frame grid, but
+    // start over from now after idle or an overrun.
+    if (frame_requested_ && !frame_timer_armed_) {
+        auto now = get_ts_ns();
+        next_frame_ts_ += frame_period_.count();
+        if (next_frame_ts_ < now) {
+            next_frame_ts_ = now;
+        }
+
+        timer_.arm_at(frame_timer_id_, std::chrono::nanoseconds(next_frame_ts_));
+        frame_timer_armed_ = true;
+    }
+
+    if (!frame_requested_) {
+        begin_idle();
+    }
+
+    frame_wakeup wakeup;
+    auto events = timer_.wait_for_events();
+    for(auto&& event : events) {
+        auto id = event.id();
+        if (id == frame_timer_id_) {
+            wake_latency_.add((get_ts_ns() - next_frame_ts_) / 1000);
+            frame_timer_armed_ = false;
+            frame_requested_ = false;
+            wakeup.frame = true;
+            frames_++;
+        } else if (id == deadline_timer_id_) {
+            deadline_ = 0;
+            wakeup.deadline = true;
+        } else if (id == input_id_) {
+            wakeup.input = true;
+        } else if (id == notify_id_) {
+            uint64_t value;
+            while (read(notify_fd_, &value, sizeof(value)) > 0) {
+            }
+            wakeup.notify = true;
+        }
+    }
+
+    if (idle_) {
+        idle_wakeups_++;
+    }
+
+    return wakeup;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+int64_t
+frame_scheduler::cpu_time()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (static_cast<int64_t>(usage.ru_utime.tv_sec) + static_cast<int64_t>(usage.ru_stime.tv_sec)) * 1000000 +
+           static_cast<int64_t>(usage.ru_utime.tv_usec) + static_cast<int64_t>(usage.ru_stime.tv_usec);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+frame_scheduler::begin_idle()
+{
+    if (idle_) {
+        return;
+    }
+
+    idle_ = true;
+    idle_periods_++;
+    idle_start_ts_ = get_ts();
+    idle_start_cpu_ = cpu_time();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+frame_scheduler::end_idle()
+{
+    if (!idle_) {
+        return;
+    }
+
+    idle_ = false;
+    idle_time_ += get_ts() - idle_start_ts_;
+    idle_cpu_time_ += cpu_time() - idle_start_cpu_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+frame_scheduler::print_stats()
+{
+    end_idle();
+
+    auto runtime = get_ts() - created_ts_;
+    double idle_share = runtime > 0 ? 100.0 * static_cast<double>(idle_time_) / static_cast<double>(runtime) : 0;
+    double idle_cpu = idle_time_ > 0 ? 100.0 * static_cast<double>(idle_cpu_time_) / static_cast<double>(idle_time_) : 0;
+
+    printf("Scheduler: %lu frames in %.1f s\n",
+           static_cast<unsigned long>(frames_),
+           static_cast<double>(runtime) / 1000000.0);
+    printf("Frame timer wake latency: %s\n", wake_latency_.summary().c_str());
+    printf("Idle: %.1f s (%.1f%% of runtime) in %lu periods, %lu wakeups, CPU while idle %.1f ms (%.3f%%)\n",
+           static_cast<double>(idle_time_) / 1000000.0,
+           idle_share,
+           static_cast<unsigned long>(idle_periods_),
+           static_cast<unsigned long>(idle_wakeups_),
+           static_cast<double>(idle_cpu_time_) / 1000.0,
+           idle_cpu);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
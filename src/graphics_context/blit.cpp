@@ -0,0 +1,565 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BLIT_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define BLIT_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include <graphics_context/blit.hpp>
+
+//---------------------------------------------------------------------------------------------------------------------------
+// Scalar kernels. Two 8 bit channels are processed per 32 bit operation.
+
+// x * a / 255 for all four channels (rounded)
+static inline uint32_t scalar_mul_un8x4(uint32_t x, uint32_t a)
+{
+    uint32_t rb = (x & 0x00ff00ff) * a + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+
+    uint32_t ag = ((x >> 8) & 0x00ff00ff) * a + 0x00800080;
+    ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+
+    return rb | ag;
+}
+
+// x + y for all four channels (saturated)
+static inline uint32_t scalar_add_un8x4(uint32_t x, uint32_t y)
+{
+    uint32_t rb = (x & 0x00ff00ff) + (y & 0x00ff00ff);
+    rb |= 0x01000100 - ((rb >> 8) & 0x00010001);
+    rb &= 0x00ff00ff;
+
+    uint32_t ag = ((x >> 8) & 0x00ff00ff) + ((y >> 8) & 0x00ff00ff);
+    ag |= 0x01000100 - ((ag >> 8) & 0x00010001);
+    ag &= 0x00ff00ff;
+
+    return rb | (ag << 8);
+}
+
+static inline uint32_t scalar_over_pixel(uint32_t d, uint32_t s)
+{
+    uint32_t sa = s >> 24;
+    if (sa == 0xff) {
+        return s;
+    }
+    if (s == 0) {
+        return d;
+    }
+    return scalar_add_un8x4(s, scalar_mul_un8x4(d, 0xff - sa));
+}
+
+static void scalar_copy(uint32_t* dst, const uint32_t* src, int n)
+{
+    memcpy(dst, src, static_cast<size_t>(n) * sizeof(uint32_t));
+}
+
+static void scalar_over(uint32_t* dst, const uint32_t* src, int n)
+{
+    for (int i = 0; i < n; i++) {
+        dst[i] = scalar_over_pixel(dst[i], src[i]);
+    }
+}
+
+static void scalar_over_alpha(uint32_t* dst, const uint32_t* src, int n, uint32_t alpha)
+{
+    for (int i = 0; i < n; i++) {
+        dst[i] = scalar_over_pixel(dst[i], scalar_mul_un8x4(src[i], alpha));
+    }
+}
+
+static void scalar_fill(uint32_t* dst, uint32_t color, int n)
+{
+    for (int i = 0; i < n; i++) {
+        dst[i] = color;
+    }
+}
+
+static const blit_kernels scalar_kernels = {
+    "scalar",
+    blit_isa::scalar,
+    scalar_copy,
+    scalar_over,
+    scalar_over_alpha,
+    scalar_fill,
+};
+
+//---------------------------------------------------------------------------------------------------------------------------
+// SSE4.1 kernels. Four pixels per iteration, widened to 16 bit lanes.
+
+#ifdef BLIT_X86
+
+// x / 255 (rounded) for 16 bit lanes holding a product of two 8 bit values
+__attribute__((target("sse4.1")))
+static inline __m128i sse41_div255_epu16(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(0x80));
+    return _mm_mulhi_epu16(x, _mm_set1_epi16(0x0101));
+}
+
+// Broadcast the alpha lane of each pixel (two pixels per register)
+__attribute__((target("sse4.1")))
+static inline __m128i sse41_alpha_epu16(__m128i px)
+{
+    px = _mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_shufflehi_epi16(px, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i sse41_over4(__m128i d, __m128i s)
+{
+    const __m128i mask_ff = _mm_set1_epi16(0xff);
+
+    __m128i s_lo = _mm_cvtepu8_epi16(s);
+    __m128i s_hi = _mm_unpackhi_epi8(s, _mm_setzero_si128());
+    __m128i d_lo = _mm_cvtepu8_epi16(d);
+    __m128i d_hi = _mm_unpackhi_epi8(d, _mm_setzero_si128());
+
+    __m128i ia_lo = _mm_xor_si128(sse41_alpha_epu16(s_lo), mask_ff);
+    __m128i ia_hi = _mm_xor_si128(sse41_alpha_epu16(s_hi), mask_ff);
+
+    d_lo = sse41_div255_epu16(_mm_mullo_epi16(d_lo, ia_lo));
+    d_hi = sse41_div255_epu16(_mm_mullo_epi16(d_hi, ia_hi));
+
+    return _mm_packus_epi16(_mm_add_epi16(s_lo, d_lo), _mm_add_epi16(s_hi, d_hi));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i sse41_mul4(__m128i s, __m128i alpha)
+{
+    __m128i s_lo = sse41_div255_epu16(_mm_mullo_epi16(_mm_cvtepu8_epi16(s), alpha));
+    __m128i s_hi = sse41_div255_epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, _mm_setzero_si128()), alpha));
+    return _mm_packus_epi16(s_lo, s_hi);
+}
+
+__attribute__((target("sse4.1")))
+static void sse41_copy(uint32_t* dst, const uint32_t* src, int n)
+{
+    memcpy(dst, src, static_cast<size_t>(n) * sizeof(uint32_t));
+}
+
+__attribute__((target("sse4.1")))
+static void sse41_over(uint32_t* dst, const uint32_t* src, int n)
+{
+    const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000));
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+        // Fully transparent: nothing to do
+        if (_mm_testz_si128(s, s)) {
+            continue;
+        }
+
+        // Fully opaque: plain copy
+        if (_mm_testc_si128(s, alpha_mask)) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), sse41_over4(d, s));
+    }
+
+    scalar_over(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+static void sse41_over_alpha(uint32_t* dst, const uint32_t* src, int n, uint32_t alpha)
+{
+    const __m128i a = _mm_set1_epi16(static_cast<short>(alpha));
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_testz_si128(s, s)) {
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), sse41_over4(d, sse41_mul4(s, a)));
+    }
+
+    scalar_over_alpha(dst + i, src + i, n - i, alpha);
+}
+
+__attribute__((target("sse4.1")))
+static void sse41_fill(uint32_t* dst, uint32_t color, int n)
+{
+    const __m128i c = _mm_set1_epi32(static_cast<int>(color));
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), c);
+    }
+
+    scalar_fill(dst + i, color, n - i);
+}
+
+static const blit_kernels sse41_kernels = {
+    "sse4.1",
+    blit_isa::sse41,
+    sse41_copy,
+    sse41_over,
+    sse41_over_alpha,
+    sse41_fill,
+};
+
+//---------------------------------------------------------------------------------------------------------------------------
+// AVX2 kernels. Eight pixels per iteration. Unpack and pack operate within
+// 128 bit lanes so the pixel order is preserved without permutes.
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_div255_epu16(__m256i x)
+{
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(0x80));
+    return _mm256_mulhi_epu16(x, _mm256_set1_epi16(0x0101));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_alpha_epu16(__m256i px)
+{
+    px = _mm256_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_shufflehi_epi16(px, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_over8(__m256i d, __m256i s)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i mask_ff = _mm256_set1_epi16(0xff);
+
+    __m256i s_lo = _mm256_unpacklo_epi8(s, zero);
+    __m256i s_hi = _mm256_unpackhi_epi8(s, zero);
+    __m256i d_lo = _mm256_unpacklo_epi8(d, zero);
+    __m256i d_hi = _mm256_unpackhi_epi8(d, zero);
+
+    __m256i ia_lo = _mm256_xor_si256(avx2_alpha_epu16(s_lo), mask_ff);
+    __m256i ia_hi = _mm256_xor_si256(avx2_alpha_epu16(s_hi), mask_ff);
+
+    d_lo = avx2_div255_epu16(_mm256_mullo_epi16(d_lo, ia_lo));
+    d_hi = avx2_div255_epu16(_mm256_mullo_epi16(d_hi, ia_hi));
+
+    return _mm256_packus_epi16(_mm256_add_epi16(s_lo, d_lo), _mm256_add_epi16(s_hi, d_hi));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_mul8(__m256i s, __m256i alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i s_lo = avx2_div255_epu16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), alpha));
+    __m256i s_hi = avx2_div255_epu16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), alpha));
+    return _mm256_packus_epi16(s_lo, s_hi);
+}
+
+__attribute__((target("avx2")))
+static void avx2_copy(uint32_t* dst, const uint32_t* src, int n)
+{
+    memcpy(dst, src, static_cast<size_t>(n) * sizeof(uint32_t));
+}
+
+__attribute__((target("avx2")))
+static void avx2_over(uint32_t* dst, const uint32_t* src, int n)
+{
+    const __m256i alpha_mask = _mm256_set1_epi32(static_cast<int>(0xff000000));
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+
+        if (_mm256_testz_si256(s, s)) {
+            continue;
+        }
+
+        if (_mm256_testc_si256(s, alpha_mask)) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), s);
+            continue;
+        }
+
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), avx2_over8(d, s));
+    }
+
+    scalar_over(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_over_alpha(uint32_t* dst, const uint32_t* src, int n, uint32_t alpha)
+{
+    const __m256i a = _mm256_set1_epi16(static_cast<short>(alpha));
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (_mm256_testz_si256(s, s)) {
+            continue;
+        }
+
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), avx2_over8(d, avx2_mul8(s, a)));
+    }
+
+    scalar_over_alpha(dst + i, src + i, n - i, alpha);
+}
+
+__attribute__((target("avx2")))
+static void avx2_fill(uint32_t* dst, uint32_t color, int n)
+{
+    const __m256i c = _mm256_set1_epi32(static_cast<int>(color));
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), c);
+    }
+
+    scalar_fill(dst + i, color, n - i);
+}
+
+static const blit_kernels avx2_kernels = {
+    "avx2",
+    blit_isa::avx2,
+    avx2_copy,
+    avx2_over,
+    avx2_over_alpha,
+    avx2_fill,
+};
+
+#endif // BLIT_X86
+
+//---------------------------------------------------------------------------------------------------------------------------
+// NEON kernels. Eight pixels per iteration, de-interleaved into planes.
+
+#ifdef BLIT_NEON
+
+// x / 255 (rounded) narrowed to 8 bit
+static inline uint8x8_t neon_div255(uint16x8_t x)
+{
+    return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+
+static inline uint8x8x4_t neon_over8(uint8x8x4_t d, uint8x8x4_t s)
+{
+    uint8x8_t ia = vmvn_u8(s.val[3]);
+    for (int c = 0; c < 4; c++) {
+        d.val[c] = vqadd_u8(s.val[c], neon_div255(vmull_u8(d.val[c], ia)));
+    }
+    return d;
+}
+
+static void neon_copy(uint32_t* dst, const uint32_t* src, int n)
+{
+    memcpy(dst, src, static_cast<size_t>(n) * sizeof(uint32_t));
+}
+
+static void neon_over(uint32_t* dst, const uint32_t* src, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint8x8x4_t s = vld4_u8(reinterpret_cast<const uint8_t*>(src + i));
+
+        uint64_t a = vget_lane_u64(vreinterpret_u64_u8(s.val[3]), 0);
+        if (a == 0) {
+            continue;
+        }
+        if (a == UINT64_MAX) {
+            vst4_u8(reinterpret_cast<uint8_t*>(dst + i), s);
+            continue;
+        }
+
+        uint8x8x4_t d = vld4_u8(reinterpret_cast<const uint8_t*>(dst + i));
+        vst4_u8(reinterpret_cast<uint8_t*>(dst + i), neon_over8(d, s));
+    }
+
+    scalar_over(dst + i, src + i, n - i);
+}
+
+static void neon_over_alpha(uint32_t* dst, const uint32_t* src, int n, uint32_t alpha)
+{
+    const uint8x8_t a = vdup_n_u8(static_cast<uint8_t>(alpha));
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint8x8x4_t s = vld4_u8(reinterpret_cast<const uint8_t*>(src + i));
+        for (int c = 0; c < 4; c++) {
+            s.val[c] = neon_div255(vmull_u8(s.val[c], a));
+        }
+
+        uint8x8x4_t d = vld4_u8(reinterpret_cast<const uint8_t*>(dst + i));
+        vst4_u8(reinterpret_cast<uint8_t*>(dst + i), neon_over8(d, s));
+    }
+
+    scalar_over_alpha(dst + i, src + i, n - i, alpha);
+}
+
+static void neon_fill(uint32_t* dst, uint32_t color, int n)
+{
+    const uint32x4_t c = vdupq_n_u32(color);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_u32(dst + i, c);
+    }
+
+    scalar_fill(dst + i, color, n - i);
+}
+
+static const blit_kernels neon_kernels = {
+    "neon",
+    blit_isa::neon,
+    neon_copy,
+    neon_over,
+    neon_over_alpha,
+    neon_fill,
+};
+
+#endif // BLIT_NEON
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+const blit_kernels* blit_kernels_for(blit_isa isa)
+{
+    switch (isa) {
+        case blit_isa::scalar:
+            return &scalar_kernels;
+        case blit_isa::sse41:
+#ifdef BLIT_X86
+            if (__builtin_cpu_supports("sse4.1")) {
+                return &sse41_kernels;
+            }
+#endif
+            return nullptr;
+        case blit_isa::avx2:
+#ifdef BLIT_X86
+            if (__builtin_cpu_supports("avx2")) {
+                return &avx2_kernels;
+            }
+#endif
+            return nullptr;
+        case blit_isa::neon:
+#ifdef BLIT_NEON
+            return &neon_kernels;
+#else
+            return nullptr;
+#endif
+    }
+
+    return nullptr;
+}
+
+static const blit_kernels* select_kernels()
+{
+    const char* env = getenv("DINO_MATH_BLIT");
+    if (env != nullptr) {
+        std::string name = env;
+        const blit_kernels* k = nullptr;
+        if (name == "scalar") {
+            k = blit_kernels_for(blit_isa::scalar);
+        } else if (name == "sse41") {
+            k = blit_kernels_for(blit_isa::sse41);
+        } else if (name == "avx2") {
+            k = blit_kernels_for(blit_isa::avx2);
+        } else if (name == "neon") {
+            k = blit_kernels_for(blit_isa::neon);
+        }
+
+        if (k != nullptr) {
+            return k;
+        }
+        printf("DINO_MATH_BLIT=%s not supported, using auto selection\n", env);
+    }
+
+    for (auto isa : { blit_isa::avx2, blit_isa::sse41, blit_isa::neon }) {
+        auto k = blit_kernels_for(isa);
+        if (k != nullptr) {
+            return k;
+        }
+    }
+
+    return &scalar_kernels;
+}
+
+const blit_kernels& blit_best_kernels()
+{
+    static const blit_kernels* kernels = select_kernels();
+    return *kernels;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void blit_copy(const blit_kernels& k, uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int width, int height)
+{
+    for (int y = 0; y < height; y++) {
+        k.copy(reinterpret_cast<uint32_t*>(dst + y * dst_stride),
+               reinterpret_cast<const uint32_t*>(src + y * src_stride),
+               width);
+    }
+}
+
+void blit_over(const blit_kernels& k, uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int width, int height)
+{
+    for (int y = 0; y < height; y++) {
+        k.over(reinterpret_cast<uint32_t*>(dst + y * dst_stride),
+               reinterpret_cast<const uint32_t*>(src + y * src_stride),
+               width);
+    }
+}
+
+void blit_over_alpha(const blit_kernels& k, uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int width, int height, uint32_t alpha)
+{
+    for (int y = 0; y < height; y++) {
+        k.over_alpha(reinterpret_cast<uint32_t*>(dst + y * dst_stride),
+                     reinterpret_cast<const uint32_t*>(src + y * src_stride),
+                     width,
+                     alpha);
+    }
+}
+
+void blit_fill(const blit_kernels& k, uint8_t* dst, int dst_stride, int width, int height, uint32_t color)
+{
+    for (int y = 0; y < height; y++) {
+        k.fill(reinterpret_cast<uint32_t*>(dst + y * dst_stride), color, width);
+    }
+}
+
+static inline uint32_t to_un8(double v)
+{
+    if (v <= 0) {
+        return 0;
+    }
+    if (v >= 1) {
+        return 0xff;
+    }
+    return static_cast<uint32_t>(v * 255.0 + 0.5);
+}
+
+uint32_t blit_rgb(double r, double g, double b)
+{
+    return 0xff000000 | (to_un8(r) << 16) | (to_un8(g) << 8) | to_un8(b);
+}
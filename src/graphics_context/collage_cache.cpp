@@ -0,0 +1,116 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <stdio.h>
+
+#include <graphics_context/collage_cache.hpp>
+
+collage_cache::collage_cache(size_t max_bytes)
+    : max_bytes_(max_bytes)
+{
+
+}
+
+std::shared_ptr<surface> collage_cache::get(const collage_key& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+        misses_++;
+        return nullptr;
+    }
+
+    hits_++;
+    it->second.last_accessed = get_ts();
+    return it->second.collage;
+}
+
+void collage_cache::put(const collage_key& key, std::shared_ptr<surface> collage)
+{
+    if (collage == nullptr || collage->handle() == nullptr) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+        resident_bytes_ -= it->second.bytes;
+        cache_.erase(it);
+    }
+
+    collage_entry entry;
+    entry.collage = collage;
+    entry.bytes = static_cast<size_t>(cairo_image_surface_get_stride(collage->handle())) *
+                  static_cast<size_t>(cairo_image_surface_get_height(collage->handle()));
+    entry.last_accessed = get_ts();
+
+    // Make room. The newest entry is always kept.
+    while (!cache_.empty() && resident_bytes_ + entry.bytes > max_bytes_) {
+        evict_least_recently_used();
+    }
+
+    resident_bytes_ += entry.bytes;
+    cache_[key] = entry;
+}
+
+void collage_cache::evict_least_recently_used()
+{
+    auto oldest = cache_.begin();
+    for (auto it = cache_.begin(); it != cache_.end(); it++) {
+        if (it->second.last_accessed < oldest->second.last_accessed) {
+            oldest = it;
+        }
+    }
+
+    resident_bytes_ -= oldest->second.bytes;
+    cache_.erase(oldest);
+    evictions_++;
+}
+
+collage_cache_stats collage_cache::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    collage_cache_stats s;
+    s.hits = hits_;
+    s.misses = misses_;
+    s.evictions = evictions_;
+    s.entries = cache_.size();
+    s.resident_bytes = resident_bytes_;
+    return s;
+}
+
+void collage_cache::print_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto lookups = hits_ + misses_;
+    double hit_ratio = lookups > 0 ? 100.0 * static_cast<double>(hits_) / static_cast<double>(lookups) : 0;
+
+    printf("Collage cache: %lu lookups, %lu hits (%.1f%%), %lu misses, %lu evictions, %zu entries, %.1f MB resident\n",
+           static_cast<unsigned long>(lookups),
+           static_cast<unsigned long>(hits_),
+           hit_ratio,
+           static_cast<unsigned long>(misses_),
+           static_cast<unsigned long>(evictions_),
+           cache_.size(),
+           static_cast<double>(resident_bytes_) / (1024.0 * 1024.0));
+}
@@ -0,0 +1,64 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <graphics_context/coverage_mask.hpp>
+#include <profiler.hpp>
+
+coverage_mask::coverage_mask(int width, int height)
+ : width_(width)
+ , height_(height)
+ , words_per_row_((static_cast<size_t>(width) + 63) / 64)
+ , bits_(words_per_row_ * static_cast<size_t>(height), 0)
+{
+}
+
+std::shared_ptr<const coverage_mask> coverage_mask::create(std::shared_ptr<surface> s)
+{
+    PROFILE_ZONE("coverage_mask::create");
+
+    auto handle = s->handle();
+    if (handle == nullptr ||
+        cairo_surface_get_type(handle) != CAIRO_SURFACE_TYPE_IMAGE ||
+        cairo_image_surface_get_format(handle) != CAIRO_FORMAT_ARGB32) {
+        return nullptr;
+    }
+
+    // Shared surfaces are immutable and already flushed
+    if (!s->immutable()) {
+        cairo_surface_flush(handle);
+    }
+
+    auto data = cairo_image_surface_get_data(handle);
+    auto stride = cairo_image_surface_get_stride(handle);
+    auto w = cairo_image_surface_get_width(handle);
+    auto h = cairo_image_surface_get_height(handle);
+
+    auto mask = std::shared_ptr<coverage_mask>(new coverage_mask(w, h));
+    for(int y = 0; y < h; y++) {
+        auto row = reinterpret_cast<const uint32_t*>(data + y * stride);
+        auto words = &mask->bits_[static_cast<size_t>(y) * mask->words_per_row_];
+        for(int x = 0; x < w; x++) {
+            if ((row[x] >> 24) >= alpha_threshold) {
+                words[x >> 6] |= uint64_t(1) << (x & 63);
+            }
+        }
+    }
+
+    return mask;
+}
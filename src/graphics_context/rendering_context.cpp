@@ -17,8 +17,14 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>
  */
 
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+
 #include <graphics_context/rendering_context.hpp>
 
+constexpr size_t resident_max_bytes = 128 * 1024 * 1024; // display server memory
+
 rendering_context::rendering_context(std::shared_ptr<screen> screen,
                   double ref_width,
                   double ref_height,
@@ -32,23 +38,74 @@ rendering_context::rendering_context(std::shared_ptr<screen> screen,
     // Assumption: using the same aspect ratio
     scale_multiplier_ = static_cast<double>(screen_->width()) / ref_width_;
 
-    auto cr = screen_->root_surface()->cr();
+    target_ = screen_->root_surface();
 
-    cairo_antialias_t cr_antialias = CAIRO_ANTIALIAS_NONE;
     switch(anti_aliasing) {
         case anti_aliasing::none:
-            cr_antialias = CAIRO_ANTIALIAS_NONE;
+            cr_antialias_ = CAIRO_ANTIALIAS_NONE;
             break;
         case anti_aliasing::fast:
-            cr_antialias = CAIRO_ANTIALIAS_FAST;
+            cr_antialias_ = CAIRO_ANTIALIAS_FAST;
             break;
         case anti_aliasing::best:
-            cr_antialias = CAIRO_ANTIALIAS_BEST;
+            cr_antialias_ = CAIRO_ANTIALIAS_BEST;
             break;
     }
-    cairo_set_antialias(cr, cr_antialias);
+    cairo_set_antialias(target_->cr(), cr_antialias_);
 
     font_face("DejaVu Sans Book", font_slant::normal, font_weight::normal);
+
+    if (screen_->create_resident_surface(1, 1, false) != nullptr) {
+        residents_ = std::make_shared<resident_cache>(screen_, resident_max_bytes);
+    }
+}
+
+void rendering_context::begin_frame()
+{
+    cairo_rectangle_t extents = { 0, 0, screen_width(), screen_height() };
+    auto recording = cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, &extents);
+    auto cr = cairo_create(recording);
+    apply_state(cr);
+
+    target_ = std::shared_ptr<surface>(new surface(recording, cr, extents.width, extents.height));
+    frame_upload_bytes_ = 0;
+}
+
+std::shared_ptr<surface> rendering_context::end_frame()
+{
+    frames_++;
+    upload_bytes_ += frame_upload_bytes_;
+    max_frame_upload_bytes_ = std::max(max_frame_upload_bytes_, frame_upload_bytes_);
+
+    auto recording = target_;
+    target_ = screen_->root_surface();
+    return recording;
+}
+
+void rendering_context::begin_layer(std::shared_ptr<surface> layer, double x, double y)
+{
+    auto cr = layer->cr();
+    apply_state(cr);
+    cairo_identity_matrix(cr);
+    cairo_translate(cr, -std::round(scale(x)), -std::round(scale(y)));
+
+    layer_prev_target_ = target_;
+    target_ = layer;
+}
+
+void rendering_context::end_layer()
+{
+    cairo_surface_flush(target_->handle());
+
+    target_ = layer_prev_target_;
+    layer_prev_target_ = nullptr;
+}
+
+void rendering_context::apply_state(cairo_t* cr)
+{
+    cairo_set_antialias(cr, cr_antialias_);
+    cairo_select_font_face(cr, font_name_.c_str(), cr_font_slant_, cr_font_weight_);
+    cairo_set_font_size(cr, cr_font_size_);
 }
 
 double rendering_context::screen_width()
@@ -73,75 +130,127 @@ double rendering_context::iscale(double value)
 
 void rendering_context::draw_surface(std::shared_ptr<surface> surface, double x, double y, double alpha)
 {
-    auto cr = screen_->root_surface()->cr();
-    cairo_set_source_surface (cr, surface->handle(), scale(x), scale(y));
-    cairo_paint_with_alpha (cr, alpha);
-    cairo_paint(cr);
+    draw_surface_px(surface, scale(x), scale(y), alpha);
+}
+
+void rendering_context::draw_layer(std::shared_ptr<surface> layer, double x, double y)
+{
+    draw_surface_px(layer, std::round(scale(x)), std::round(scale(y)), 1.0);
+}
+
+void rendering_context::draw_surface_px(std::shared_ptr<surface> surface, double x, double y, double alpha)
+{
+    if (residents_ != nullptr) {
+        auto resident = surface->immutable() ? residents_->get(surface) : nullptr;
+        if (resident != nullptr) {
+            target_->draw_surface(resident, x, y, alpha);
+            return;
+        }
+
+        frame_upload_bytes_ += surface->bytes();
+    }
+
+    target_->draw_surface(surface, x, y, alpha);
+}
+
+void rendering_context::draw_surface_area(std::shared_ptr<surface> surface, double x, double y, const rect& area)
+{
+    auto x1 = floor(scale(area.x));
+    auto y1 = floor(scale(area.y));
+    auto x2 = ceil(scale(area.x + area.width));
+    auto y2 = ceil(scale(area.y + area.height));
+
+    auto cr = target_->cr();
+    cairo_save(cr);
+    cairo_rectangle(cr, x1, y1, x2 - x1, y2 - y1);
+    cairo_clip(cr);
+    draw_surface(surface, x, y, 1.0);
+    cairo_restore(cr);
+}
+
+void rendering_context::print_stats()
+{
+    if (residents_ == nullptr) {
+        return;
+    }
+
+    auto rs = residents_->stats();
+    printf("Resident surfaces: %zu entries, %.1f MB, %lu uploads, %lu hits, %lu evictions\n",
+           rs.entries,
+           static_cast<double>(rs.resident_bytes) / (1024.0 * 1024.0),
+           static_cast<unsigned long>(rs.uploads),
+           static_cast<unsigned long>(rs.hits),
+           static_cast<unsigned long>(rs.evictions));
+
+    printf("Client pixels sent: %.1f KB per frame, max %.1f KB, %.1f MB total\n",
+           frames_ > 0 ? static_cast<double>(upload_bytes_) / static_cast<double>(frames_) / 1024.0 : 0.0,
+           static_cast<double>(max_frame_upload_bytes_) / 1024.0,
+           static_cast<double>(upload_bytes_) / (1024.0 * 1024.0));
 }
 
 void rendering_context::set_source_rgb(double r, double g, double b)
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_set_source_rgb(cr, r, g, b);
 }
 
 void rendering_context::set_source_rgba(double r, double g, double b, double a)
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_set_source_rgba(cr, r, g, b, a);
 }
 
 void rendering_context::line_width(double width)
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_set_line_width(cr, scale(width));
 }
 
 void rendering_context::move_to(double x, double y)
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_move_to(cr, scale(x), scale(y));
 }
 
 void rendering_context::line_to(double x, double y)
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_line_to(cr, scale(x), scale(y));
 }
 
 void rendering_context::close_path()
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_close_path(cr);
 }
 
 void rendering_context::arc(double xc, double yc, double radius, double angle1, double angle2)
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_arc(cr, scale(xc), scale(yc), scale(radius), angle1, angle2);
 }
 
 void rendering_context::rectangle(double x, double y, double width, double height)
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_rectangle(cr, scale(x), scale(y), scale(width), scale(height));
 }
 
 void rendering_context::fill()
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_fill(cr);
 }
 
 void rendering_context::stroke()
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_stroke(cr);
 }
 
 void rendering_context::paint()
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_paint(cr);
 }
 
@@ -172,19 +281,25 @@ void rendering_context::font_face(std::string name, font_slant slant, font_weigh
             break;
     }
     
-    auto cr = screen_->root_surface()->cr();
+    font_name_ = name;
+    cr_font_slant_ = cr_slant;
+    cr_font_weight_ = cr_weight;
+
+    auto cr = target_->cr();
     cairo_select_font_face(cr, name.c_str(), cr_slant, cr_weight);
 }
 
 void rendering_context::font_size(double size)
 {
-    auto cr = screen_->root_surface()->cr();
-    cairo_set_font_size(cr, scale(size));
+    cr_font_size_ = scale(size);
+
+    auto cr = target_->cr();
+    cairo_set_font_size(cr, cr_font_size_);
 }
 
 void rendering_context::show_text(std::string text)
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_show_text(cr, text.c_str());
 }
 
@@ -192,7 +307,7 @@ void rendering_context::set_dash(const double* dashes,
                       int num_dashes,
                       double offset)
 {
-    auto cr = screen_->root_surface()->cr();
+    auto cr = target_->cr();
     cairo_set_dash (cr,
                     dashes,
                     num_dashes,
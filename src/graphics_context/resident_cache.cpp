@@ -0,0 +1,132 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include <graphics_context/resident_cache.hpp>
+#include <profiler.hpp>
+
+resident_cache::resident_cache(std::shared_ptr<screen> screen, size_t max_bytes)
+    : screen_(screen)
+    , max_bytes_(max_bytes)
+{
+
+}
+
+std::shared_ptr<surface> resident_cache::get(const std::shared_ptr<surface>& image)
+{
+    auto it = entries_.find(image.get());
+    if (it != entries_.end()) {
+        // The address may belong to an image freed since
+        if (it->second.image.lock() == image) {
+            hits_++;
+            it->second.last_used = get_ts();
+            return it->second.resident;
+        }
+
+        resident_bytes_ -= it->second.bytes;
+        entries_.erase(it);
+    }
+
+    auto bytes = image->bytes();
+    if (bytes == 0 || bytes > max_bytes_) {
+        return nullptr;
+    }
+
+    // Misses are rare (new assets), a good time to look for dead entries
+    purge_expired_entries();
+
+    while (!entries_.empty() && resident_bytes_ + bytes > max_bytes_) {
+        evict_least_recently_used();
+    }
+
+    auto resident = upload(image);
+    if (resident == nullptr) {
+        return nullptr;
+    }
+
+    resident_entry entry;
+    entry.image = image;
+    entry.resident = resident;
+    entry.bytes = bytes;
+    entry.last_used = get_ts();
+    entries_[image.get()] = entry;
+    resident_bytes_ += bytes;
+
+    return resident;
+}
+
+std::shared_ptr<surface> resident_cache::upload(const std::shared_ptr<surface>& image)
+{
+    PROFILE_ZONE("resident_cache::upload");
+
+    auto w = image->width();
+    auto h = image->height();
+    auto resident = screen_->create_resident_surface(static_cast<int>(w), static_cast<int>(h), image->opaque());
+    if (resident == nullptr) {
+        return nullptr;
+    }
+
+    // One transfer, later draws reference the server copy
+    auto cr = resident->cr();
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface(cr, image->handle(), 0, 0);
+    cairo_paint(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+    cairo_surface_flush(resident->handle());
+
+    uploads_++;
+    return resident;
+}
+
+void resident_cache::purge_expired_entries()
+{
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.image.expired()) {
+            resident_bytes_ -= it->second.bytes;
+            it = entries_.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void resident_cache::evict_least_recently_used()
+{
+    auto oldest = entries_.begin();
+    for (auto it = entries_.begin(); it != entries_.end(); it++) {
+        if (it->second.last_used < oldest->second.last_used) {
+            oldest = it;
+        }
+    }
+
+    resident_bytes_ -= oldest->second.bytes;
+    entries_.erase(oldest);
+    evictions_++;
+}
+
+resident_cache_stats resident_cache::stats()
+{
+    resident_cache_stats s;
+    s.hits = hits_;
+    s.uploads = uploads_;
+    s.evictions = evictions_;
+    s.entries = entries_.size();
+    s.resident_bytes = resident_bytes_;
+    return s;
+}
@@ -17,18 +17,22 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>
  */
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
 
 #include <graphics_context/surface.hpp>
+#include <graphics_context/blit.hpp>
+#include <profiler.hpp>
 
 surface::surface()
 {
 }
 
-surface::surface(double width, double height)
+surface::surface(double width, double height, bool opaque)
  : width_(width)
  , height_(height)
+ , opaque_(opaque)
 {
 }
 
@@ -60,7 +64,7 @@ void surface::destroy()
 
 void surface::load_background(double r, double g, double b)
 {
-    surface_ = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width_, height_);
+    surface_ = cairo_image_surface_create(opaque_ ? CAIRO_FORMAT_RGB24 : CAIRO_FORMAT_ARGB32, width_, height_);
 
     if (surface_ != nullptr) {
         cr_ = cairo_create(surface_);
@@ -73,8 +77,21 @@ void surface::load_background(double r, double g, double b)
     }
 }
 
+void surface::load_transparent()
+{
+    surface_ = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width_, height_);
+
+    if (surface_ != nullptr) {
+        cr_ = cairo_create(surface_);
+        width_ = static_cast<double>(cairo_image_surface_get_width(surface_));
+        height_ = static_cast<double>(cairo_image_surface_get_height(surface_));
+    }
+}
+
 void surface::load_from_svg(std::string path)
 {
+    PROFILE_ZONE("surface::load_from_svg");
+
     std::ifstream f(path, std::ios::in|std::ios::binary|std::ios::ate);
     if (!f.is_open()) {
         return; // todo: exception
@@ -142,6 +159,8 @@ void surface::load_from_svg(std::string path)
 
 void surface::load_from_png(std::string path)
 {
+    PROFILE_ZONE("surface::load_from_png");
+
     surface_ = cairo_image_surface_create_from_png(path.c_str());
 
     if (surface_ != nullptr) {
@@ -151,12 +170,14 @@ void surface::load_from_png(std::string path)
     }
 }
 
-void surface::write_png(std::string path)
+bool surface::write_png(std::string path)
 {
-    if (surface_ != nullptr) {
-        printf("Writing %s\n", path.c_str());
-        cairo_surface_write_to_png(surface_, path.c_str());
+    if (surface_ == nullptr) {
+        return false;
     }
+
+    printf("Writing %s\n", path.c_str());
+    return cairo_surface_write_to_png(surface_, path.c_str()) == CAIRO_STATUS_SUCCESS;
 }
 
 void surface::fill(double r, double g, double b) {
@@ -164,19 +185,225 @@ void surface::fill(double r, double g, double b) {
         return;
     }
 
+    auto op = cairo_get_operator(cr_);
+    if (is_image_surface() && has_identity_transform() &&
+        (op == CAIRO_OPERATOR_OVER || op == CAIRO_OPERATOR_SOURCE) &&
+        clip_contains(0, 0, cairo_image_surface_get_width(surface_), cairo_image_surface_get_height(surface_))) {
+        cairo_surface_flush(surface_);
+
+        auto w = cairo_image_surface_get_width(surface_);
+        auto h = cairo_image_surface_get_height(surface_);
+        blit_fill(blit_best_kernels(),
+                  cairo_image_surface_get_data(surface_),
+                  cairo_image_surface_get_stride(surface_),
+                  w, h, blit_rgb(r, g, b));
+
+        cairo_surface_mark_dirty(surface_);
+        return;
+    }
+
     cairo_set_source_rgb(cr_, r, g, b);
     cairo_rectangle(cr_, 0, 0, width_, height_);
     cairo_fill(cr_);
 }
 
+void surface::set_immutable()
+{
+    if (surface_ != nullptr) {
+        cairo_surface_flush(surface_);
+    }
+    immutable_ = true;
+}
+
+size_t surface::bytes()
+{
+    if (!is_image_surface()) {
+        return 0;
+    }
+
+    return static_cast<size_t>(cairo_image_surface_get_stride(surface_)) *
+           static_cast<size_t>(cairo_image_surface_get_height(surface_));
+}
+
+uint64_t surface::digest()
+{
+    if (!is_image_surface()) {
+        return 0;
+    }
+
+    if (!immutable_) {
+        cairo_surface_flush(surface_);
+    }
+
+    // Row by row, the stride padding is undefined. So is the alpha byte
+    // of RGB24.
+    auto data = cairo_image_surface_get_data(surface_);
+    auto stride = cairo_image_surface_get_stride(surface_);
+    auto w = cairo_image_surface_get_width(surface_);
+    auto h = cairo_image_surface_get_height(surface_);
+    uint32_t mask = cairo_image_surface_get_format(surface_) == CAIRO_FORMAT_RGB24 ? 0x00ffffff : 0xffffffff;
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(int y = 0; y < h; y++) {
+        auto row = reinterpret_cast<const uint32_t*>(data + y * stride);
+        for(int x = 0; x < w; x++) {
+            auto pixel = row[x] & mask;
+            for(int i = 0; i < 4; i++) {
+                hash = (hash ^ ((pixel >> (8 * i)) & 0xff)) * 0x100000001b3ULL;
+            }
+        }
+    }
+
+    return hash;
+}
+
+bool surface::opaque()
+{
+    return surface_ != nullptr && cairo_surface_get_content(surface_) == CAIRO_CONTENT_COLOR;
+}
+
+bool surface::is_image_surface()
+{
+    return surface_ != nullptr &&
+           cairo_surface_status(surface_) == CAIRO_STATUS_SUCCESS &&
+           cairo_surface_get_type(surface_) == CAIRO_SURFACE_TYPE_IMAGE;
+}
+
+bool surface::has_identity_transform()
+{
+    cairo_matrix_t m;
+    cairo_get_matrix(cr_, &m);
+    return m.xx == 1 && m.yy == 1 && m.xy == 0 && m.yx == 0 && m.x0 == 0 && m.y0 == 0;
+}
+
+bool surface::clip_contains(int x, int y, int width, int height)
+{
+    // Unclipped contexts report one rectangle covering the surface.
+    // Clips that are not rectangles are never taken to contain anything.
+    auto list = cairo_copy_clip_rectangle_list(cr_);
+    bool contained = false;
+    if (list->status == CAIRO_STATUS_SUCCESS) {
+        for(int i = 0; i < list->num_rectangles && !contained; i++) {
+            auto& r = list->rectangles[i];
+            contained = r.x <= x && r.y <= y &&
+                        r.x + r.width >= x + width && r.y + r.height >= y + height;
+        }
+    }
+    cairo_rectangle_list_destroy(list);
+
+    return contained;
+}
+
+bool surface::blit_surface(std::shared_ptr<surface> surface, double x, double y, double alpha)
+{
+    // Only whole pixel offsets between 32 bit image surfaces
+    if (!is_image_surface() || !surface->is_image_surface() || !has_identity_transform()) {
+        return false;
+    }
+
+    // The kernels composite OVER. cairo_paint() with any other operator
+    // also affects pixels outside the image.
+    if (cairo_get_operator(cr_) != CAIRO_OPERATOR_OVER) {
+        return false;
+    }
+
+    if (x != static_cast<int>(x) || y != static_cast<int>(y)) {
+        return false;
+    }
+
+    auto src = surface->handle();
+    auto src_format = cairo_image_surface_get_format(src);
+    auto dst_format = cairo_image_surface_get_format(surface_);
+    if ((src_format != CAIRO_FORMAT_ARGB32 && src_format != CAIRO_FORMAT_RGB24) ||
+        (dst_format != CAIRO_FORMAT_ARGB32 && dst_format != CAIRO_FORMAT_RGB24)) {
+        return false;
+    }
+
+    // Alpha byte of RGB24 is undefined, only plain copies are possible
+    if (src_format == CAIRO_FORMAT_RGB24 && (dst_format != CAIRO_FORMAT_RGB24 || alpha < 1.0)) {
+        return false;
+    }
+
+    if (alpha <= 0) {
+        return true;
+    }
+
+    // Clip source rectangle against destination
+    int dx = static_cast<int>(x);
+    int dy = static_cast<int>(y);
+    int sx = 0;
+    int sy = 0;
+    int w = cairo_image_surface_get_width(src);
+    int h = cairo_image_surface_get_height(src);
+
+    if (dx < 0) {
+        sx = -dx;
+        w += dx;
+        dx = 0;
+    }
+    if (dy < 0) {
+        sy = -dy;
+        h += dy;
+        dy = 0;
+    }
+    w = std::min(w, cairo_image_surface_get_width(surface_) - dx);
+    h = std::min(h, cairo_image_surface_get_height(surface_) - dy);
+    if (w <= 0 || h <= 0) {
+        return true;
+    }
+
+    if (!clip_contains(dx, dy, w, h)) {
+        return false;
+    }
+
+    // Shared sources are immutable and already flushed
+    if (!surface->immutable()) {
+        cairo_surface_flush(src);
+    }
+    cairo_surface_flush(surface_);
+
+    int src_stride = cairo_image_surface_get_stride(src);
+    int dst_stride = cairo_image_surface_get_stride(surface_);
+    const uint8_t* src_data = cairo_image_surface_get_data(src) + sy * src_stride + sx * 4;
+    uint8_t* dst_data = cairo_image_surface_get_data(surface_) + dy * dst_stride + dx * 4;
+
+    auto& k = blit_best_kernels();
+    uint32_t a = static_cast<uint32_t>(alpha * 255.0 + 0.5);
+
+    if (src_format == CAIRO_FORMAT_RGB24) {
+        blit_copy(k, dst_data, dst_stride, src_data, src_stride, w, h);
+    } else if (a >= 255) {
+        blit_over(k, dst_data, dst_stride, src_data, src_stride, w, h);
+    } else {
+        blit_over_alpha(k, dst_data, dst_stride, src_data, src_stride, w, h, a);
+    }
+
+    cairo_surface_mark_dirty_rectangle(surface_, dx, dy, w, h);
+    return true;
+}
+
 void surface::draw_surface(std::shared_ptr<surface> surface, double x, double y, double alpha)
 {
     if (cr_ == nullptr) {
         return;
     }
 
+    if (blit_surface(surface, x, y, alpha)) {
+        return;
+    }
+
     cairo_set_source_surface (cr_, surface->handle(), x, y);
-    cairo_paint_with_alpha (cr_, alpha);
-    cairo_paint(cr_);
+    auto op = cairo_get_operator(cr_);
+    if (alpha >= 1.0 && surface->opaque() && op == CAIRO_OPERATOR_OVER) {
+        // Nothing to blend, copy. The rectangle keeps SOURCE from clearing
+        // the destination outside the image.
+        cairo_set_operator(cr_, CAIRO_OPERATOR_SOURCE);
+        cairo_rectangle(cr_, x, y, surface->width(), surface->height());
+        cairo_fill(cr_);
+        cairo_set_operator(cr_, op);
+    } else if (alpha >= 1.0) {
+        cairo_paint(cr_);
+    } else {
+        cairo_paint_with_alpha (cr_, alpha);
+    }
 }
-
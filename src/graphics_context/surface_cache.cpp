@@ -18,6 +18,8 @@
  */
 
 #include <vector>
+#include <errno.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <pthread.h>
@@ -33,6 +35,7 @@
 static pthread_mutex_t utils_basename_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 #include <graphics_context/surface_cache.hpp>
+#include <profiler.hpp>
 
 surface_cache::surface_cache(int screen_width, int screen_height)
     : screen_width_(screen_width)
@@ -105,16 +108,32 @@ std::string surface_cache::get_dino_root()
 
 void surface_cache::update_persistent_png_cache(std::string path, double width, double height, std::shared_ptr<surface> surface)
 {
+    auto root = get_dino_root();
+    if (mkdir(root.c_str(), 0755) != 0 && errno != EEXIST) {
+        perror(root.c_str());
+        return;
+    }
 
-    std::string cmd = "mkdir -p " + get_dino_root();
-    system(cmd.c_str());
-    std::string cache_path = get_dino_root() + "/" + get_cache_filename(path, width, height);
+    std::string cache_path = root + "/" + get_cache_filename(path, width, height);
 
     if (path_exists(cache_path)) {
         return;
     }
 
-    surface->write_png(cache_path.c_str());
+    // Concurrent misses of the same key (logic thread and task worker, or
+    // another instance) each write their own file. rename() replaces
+    // atomically, readers never see a partial PNG.
+    std::string tmp_path = cache_path + ".XXXXXX";
+    auto fd = mkstemp(&tmp_path[0]);
+    if (fd < 0) {
+        perror(tmp_path.c_str());
+        return;
+    }
+    close(fd);
+
+    if (!surface->write_png(tmp_path) || rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+    }
 }
 
 std::shared_ptr<surface> surface_cache::load_from_persistent_cache(std::string path, double width, double height)
@@ -126,48 +145,99 @@ std::shared_ptr<surface> surface_cache::load_from_persistent_cache(std::string p
         return nullptr;
     }
 
-    return get_png_surface(cache_path);
+    auto s = std::shared_ptr<surface>(new surface());
+    s->load_from_png(cache_path);
+    return s;
+}
+
+std::shared_ptr<surface> surface_cache::lookup(const surface_key& key)
+{
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+        return nullptr;
+    }
+
+    it->second.last_accessed = get_ts();
+    return it->second.cached_surface;
+}
+
+std::shared_ptr<surface> surface_cache::insert(const surface_key& key, std::shared_ptr<surface> s)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_loads_--;
+
+    auto cached = lookup(key);
+    if (cached != nullptr) {
+        return cached;
+    }
+
+    // Shared by everyone, nobody draws onto cached surfaces
+    s->set_immutable();
+
+    cache_entry entry;
+    entry.last_accessed = get_ts();
+    entry.cached_surface = s;
+    entry.mask_built = false;
+    entry.bytes = s->bytes();
+    resident_bytes_ += entry.bytes;
+    cache_[key] = entry;
+    return s;
 }
 
 std::shared_ptr<surface> surface_cache::get_svg_surface(std::string path, double width, double height)
 {
+    PROFILE_ZONE("surface_cache::get_svg_surface");
+
     //purge_outdated_entries();
 
     auto key = create_key(path, width, height);
 
     // Already available
-    if (cache_.find(key) != cache_.end()) {
-        cache_[key].last_accessed = get_ts();
-        return cache_[key].cached_surface;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto cached = lookup(key);
+        if (cached != nullptr) {
+            hits_++;
+            return cached;
+        }
+        misses_++;
+        pending_loads_++;
     }
 
-    auto s = load_from_persistent_cache(path, width, height);
+    // Rendered by an earlier run. Kept under the svg key, so the
+    // persistent cache is only consulted once per size.
+    auto s = persistent_cache_ ? load_from_persistent_cache(path, width, height) : nullptr;
     if (s == nullptr) {
         // Create
         s = std::shared_ptr<surface>(new surface(width, height));
         s->load_from_svg(path);
-        update_persistent_png_cache(path, width, height, s);
-
-        // Populate cache   
-        cache_entry entry;
-        entry.last_accessed = get_ts();
-        entry.cached_surface = s;
-        cache_[key] = entry;
+        if (persistent_cache_) {
+            update_persistent_png_cache(path, width, height, s);
+        }
     }
 
-    return s;
+    // Populate cache
+    return insert(key, s);
 }
 
 std::shared_ptr<surface> surface_cache::get_png_surface(std::string path)
 {
+    PROFILE_ZONE("surface_cache::get_png_surface");
+
     //purge_outdated_entries();
 
     auto key = create_key(path, 0, 0);
 
     // Already available
-    if (cache_.find(key) != cache_.end()) {
-        cache_[key].last_accessed = get_ts();
-        return cache_[key].cached_surface;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto cached = lookup(key);
+        if (cached != nullptr) {
+            hits_++;
+            return cached;
+        }
+        misses_++;
+        pending_loads_++;
     }
 
     // Create
@@ -175,16 +245,64 @@ std::shared_ptr<surface> surface_cache::get_png_surface(std::string path)
     s->load_from_png(path);
 
     // Populate cache
-    cache_entry entry;
-    entry.last_accessed = get_ts();
-    entry.cached_surface = s;
-    cache_[key] = entry;
+    return insert(key, s);
+}
+
+std::shared_ptr<const coverage_mask> surface_cache::get_svg_mask(std::string path, double width, double height)
+{
+    auto key = create_key(path, width, height);
 
+    std::shared_ptr<surface> s;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(key);
+        if (it == cache_.end()) {
+            return nullptr;
+        }
+        if (it->second.mask_built) {
+            return it->second.mask;
+        }
+        s = it->second.cached_surface;
+    }
+
+    // Outside the lock, the surface is immutable. Concurrent first calls
+    // may both build it, one is kept.
+    auto mask = coverage_mask::create(s);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+        return mask;
+    }
+
+    if (!it->second.mask_built) {
+        it->second.mask = mask;
+        it->second.mask_built = true;
+        if (mask != nullptr) {
+            it->second.bytes += mask->bytes();
+            resident_bytes_ += mask->bytes();
+        }
+    }
+    return it->second.mask;
+}
+
+surface_cache_stats surface_cache::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    surface_cache_stats s;
+    s.hits = hits_;
+    s.misses = misses_;
+    s.entries = cache_.size();
+    s.resident_bytes = resident_bytes_;
+    s.pending_loads = pending_loads_;
     return s;
 }
 
 void surface_cache::purge_outdated_entries()
 {
+    std::lock_guard<std::mutex> lock(mutex_);
+
     std::vector<std::string> keys_to_remove;
 
     for(auto&& e : cache_) {
@@ -193,6 +311,7 @@ void surface_cache::purge_outdated_entries()
         auto elapsed_time_ms = (get_ts() - e.second.last_accessed) / 1000;
         if (elapsed_time_ms > 60000) {
             keys_to_remove.emplace_back(key);
+            resident_bytes_ -= e.second.bytes;
             e.second.cached_surface = nullptr;
         }
     }
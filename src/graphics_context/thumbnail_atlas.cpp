@@ -0,0 +1,140 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include <graphics_context/blit.hpp>
+#include <graphics_context/thumbnail_atlas.hpp>
+#include <profiler.hpp>
+
+thumbnail_atlas::thumbnail_atlas(std::shared_ptr<surface_cache> sur_cache,
+                                 std::vector<std::string>& svg_paths,
+                                 int thumbnail_width,
+                                 int thumbnail_height)
+    : thumbnail_width_(thumbnail_width)
+    , thumbnail_height_(thumbnail_height)
+{
+    nr_thumbnails_ = static_cast<int>(svg_paths.size());
+
+    atlas_ = std::shared_ptr<surface>(new surface(std::max(1, nr_thumbnails_ * thumbnail_width_),
+                                                  std::max(1, thumbnail_height_)));
+    atlas_->load_transparent();
+
+    auto cr = atlas_->cr();
+
+    // Each thumbnail is clipped to its slot
+    int slot_x = 0;
+    for(auto&& svg_path : svg_paths) {
+        auto s = sur_cache->get_svg_surface(svg_path, thumbnail_width_, thumbnail_height_);
+        if (s != nullptr && s->handle() != nullptr) {
+            cairo_save(cr);
+            cairo_rectangle(cr, slot_x, 0, thumbnail_width_, thumbnail_height_);
+            cairo_clip(cr);
+            cairo_set_source_surface(cr, s->handle(), slot_x, 0);
+            cairo_paint(cr);
+            cairo_restore(cr);
+        }
+        slot_x += thumbnail_width_;
+    }
+
+    cairo_surface_flush(atlas_->handle());
+}
+
+void thumbnail_atlas::compose_rows(uint8_t* dst_data,
+                                   int dst_stride,
+                                   int dst_width,
+                                   int dst_height,
+                                   const std::vector<int>& indices,
+                                   int nr_cols,
+                                   int row_begin,
+                                   int row_end)
+{
+    PROFILE_ZONE("thumbnail_atlas::compose_rows");
+
+    auto& k = blit_best_kernels();
+    auto atlas_data = cairo_image_surface_get_data(atlas_->handle());
+    auto atlas_stride = cairo_image_surface_get_stride(atlas_->handle());
+    int nr_cells = static_cast<int>(indices.size());
+
+    for(int row = row_begin; row < row_end; row++) {
+        int y0 = row * thumbnail_height_;
+        int lines = std::min(thumbnail_height_, dst_height - y0);
+
+        // Batch the whole grid row: write each destination scanline once
+        for(int line = 0; line < lines; line++) {
+            auto dst_line = reinterpret_cast<uint32_t*>(dst_data + (y0 + line) * dst_stride);
+            auto atlas_line = reinterpret_cast<const uint32_t*>(atlas_data + line * atlas_stride);
+
+            for(int col = 0; col < nr_cols; col++) {
+                int cell = row * nr_cols + col;
+                if (cell >= nr_cells) {
+                    break;
+                }
+
+                int x0 = col * thumbnail_width_;
+                int w = std::min(thumbnail_width_, dst_width - x0);
+                if (w <= 0) {
+                    break;
+                }
+
+                k.over(dst_line + x0, atlas_line + indices[cell] * thumbnail_width_, w);
+            }
+        }
+    }
+}
+
+void thumbnail_atlas::compose(std::shared_ptr<surface> dst, const std::vector<int>& indices, int nr_cols, int nr_threads)
+{
+    if (dst == nullptr || dst->handle() == nullptr || nr_cols <= 0 || nr_thumbnails_ == 0) {
+        return;
+    }
+
+    auto handle = dst->handle();
+    cairo_surface_flush(handle);
+
+    auto dst_data = cairo_image_surface_get_data(handle);
+    auto dst_stride = cairo_image_surface_get_stride(handle);
+    auto dst_width = cairo_image_surface_get_width(handle);
+    auto dst_height = cairo_image_surface_get_height(handle);
+
+    int nr_rows = (static_cast<int>(indices.size()) + nr_cols - 1) / nr_cols;
+    nr_rows = std::min(nr_rows, (dst_height + thumbnail_height_ - 1) / thumbnail_height_);
+
+    nr_threads = std::max(1, std::min(nr_threads, nr_rows));
+    if (nr_threads == 1) {
+        compose_rows(dst_data, dst_stride, dst_width, dst_height, indices, nr_cols, 0, nr_rows);
+    } else {
+        // Row bands do not overlap, no locking needed
+        std::vector<std::thread> workers;
+        int band = (nr_rows + nr_threads - 1) / nr_threads;
+        for(int row_begin = 0; row_begin < nr_rows; row_begin += band) {
+            int row_end = std::min(nr_rows, row_begin + band);
+            workers.emplace_back(&thumbnail_atlas::compose_rows, this,
+                                 dst_data, dst_stride, dst_width, dst_height,
+                                 std::cref(indices), nr_cols, row_begin, row_end);
+        }
+
+        for(auto&& w : workers) {
+            w.join();
+        }
+    }
+
+    cairo_surface_mark_dirty(handle);
+}
@@ -0,0 +1,205 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <string.h>
+
+#include <input_log.hpp>
+
+constexpr char input_log_magic[4] = { 'D', 'M', 'I', 'L' };
+constexpr uint32_t input_log_version = 1;
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+input_log_writer::~input_log_writer()
+{
+    close();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+template<typename T>
+void
+input_log_writer::put(T value)
+{
+    auto offset = buffer_.size();
+    buffer_.resize(offset + sizeof(value));
+    memcpy(buffer_.data() + offset, &value, sizeof(value));
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+bool
+input_log_writer::open(const std::string& path, uint64_t seed, int width, int height, int64_t start_ts)
+{
+    file_ = fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        perror(path.c_str());
+        return false;
+    }
+    start_ts_ = start_ts;
+
+    buffer_.clear();
+    buffer_.insert(buffer_.end(), input_log_magic, input_log_magic + sizeof(input_log_magic));
+    put(input_log_version);
+    put(seed);
+    put(static_cast<int32_t>(width));
+    put(static_cast<int32_t>(height));
+    fwrite(buffer_.data(), 1, buffer_.size(), file_);
+
+    printf("Recording input to %s\n", path.c_str());
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+input_log_writer::write_frame(int64_t ts, event_span<ui_event> events)
+{
+    if (file_ == nullptr) {
+        return;
+    }
+
+    buffer_.clear();
+    put(ts - start_ts_);
+    put(static_cast<uint16_t>(events.size()));
+    for(auto&& event : events) {
+        put(event.get_receive_ts() - start_ts_);
+        put(event.get_server_ts());
+        put(static_cast<uint8_t>(event.get_type()));
+        put(static_cast<uint8_t>(event.get_c()));
+        put(static_cast<uint16_t>(event.get_button_state()));
+        put(static_cast<int32_t>(event.get_x()));
+        put(static_cast<int32_t>(event.get_y()));
+    }
+
+    // Buffered by stdio, flushed on close
+    fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    frames_++;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+input_log_writer::close()
+{
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+        printf("Recorded %lu frames of input\n", static_cast<unsigned long>(frames_));
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+input_log_reader::~input_log_reader()
+{
+    close();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+template<typename T>
+bool
+input_log_reader::get(T& value)
+{
+    return fread(&value, sizeof(value), 1, file_) == 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+bool
+input_log_reader::open(const std::string& path)
+{
+    file_ = fopen(path.c_str(), "rb");
+    if (file_ == nullptr) {
+        perror(path.c_str());
+        return false;
+    }
+
+    char magic[sizeof(input_log_magic)];
+    uint32_t version = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    if (fread(magic, sizeof(magic), 1, file_) != 1 ||
+        memcmp(magic, input_log_magic, sizeof(magic)) != 0 ||
+        !get(version) || !get(seed_) || !get(width) || !get(height)) {
+        printf("Error: %s is not an input log\n", path.c_str());
+        close();
+        return false;
+    }
+
+    if (version != input_log_version) {
+        printf("Error: %s has version %u, expected %u\n", path.c_str(), version, input_log_version);
+        close();
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+bool
+input_log_reader::read_frame(int64_t& ts, std::vector<ui_event>& events)
+{
+    events.clear();
+
+    uint16_t nr_events = 0;
+    if (file_ == nullptr || !get(ts) || !get(nr_events)) {
+        return false;
+    }
+
+    for(uint16_t i = 0; i < nr_events; i++) {
+        int64_t receive_ts;
+        uint32_t server_ts;
+        uint8_t type;
+        uint8_t c;
+        uint16_t buttons;
+        int32_t x;
+        int32_t y;
+        if (!get(receive_ts) || !get(server_ts) || !get(type) || !get(c) ||
+            !get(buttons) || !get(x) || !get(y)) {
+            printf("Error: input log truncated\n");
+            return false;
+        }
+
+        ui_event event(static_cast<ui_event_type>(type), x, y, static_cast<button>(buttons));
+        event.set_c(static_cast<char>(c));
+        event.set_receive_ts(receive_ts);
+        event.set_server_ts(server_ts);
+        events.emplace_back(event);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+input_log_reader::close()
+{
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
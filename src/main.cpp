@@ -21,6 +21,7 @@
 #include <getopt.h>
 #include <sstream>
 
+#include <benchmark.hpp>
 #include <dino_math.hpp>
 
 //-------------------------------------------------------------------------------------------------------------------
@@ -34,6 +35,16 @@ static bool g_fullscreen = false;
 static bool g_help = false;
 static int g_screen_width = default_screen_width;
 static int g_screen_height = default_screen_height;
+static std::string g_benchmark;
+static bool g_latency = false;
+static bool g_xcb = false;
+static std::string g_record;
+static std::string g_replay;
+static bool g_unthrottled = false;
+static std::string g_frame_digests;
+static std::string g_dump_frames;
+static bool g_seed_set = false;
+static uint64_t g_seed = 0;
 
 //-------------------------------------------------------------------------------------------------------------------
 
@@ -42,6 +53,15 @@ enum cli_option
     cli_option_fullscreen = 1000, // value higher thann short options
     cli_option_screen_width,
     cli_option_screen_height,
+    cli_option_benchmark,
+    cli_option_latency,
+    cli_option_xcb,
+    cli_option_record,
+    cli_option_replay,
+    cli_option_unthrottled,
+    cli_option_frame_digests,
+    cli_option_dump_frames,
+    cli_option_seed,
     cli_option_help,
 };
 
@@ -51,6 +71,15 @@ static struct option long_options[] = {
     { "fullscreen",     no_argument,       nullptr,  cli_option_fullscreen    },
     { "screen-width",   required_argument, nullptr,  cli_option_screen_width  },
     { "screen-height",  required_argument, nullptr,  cli_option_screen_height },
+    { "benchmark",      required_argument, nullptr,  cli_option_benchmark     },
+    { "latency",        no_argument,       nullptr,  cli_option_latency       },
+    { "xcb",            no_argument,       nullptr,  cli_option_xcb           },
+    { "record",         required_argument, nullptr,  cli_option_record        },
+    { "replay",         required_argument, nullptr,  cli_option_replay        },
+    { "unthrottled",    no_argument,       nullptr,  cli_option_unthrottled   },
+    { "frame-digests",  required_argument, nullptr,  cli_option_frame_digests },
+    { "dump-frames",    required_argument, nullptr,  cli_option_dump_frames   },
+    { "seed",           required_argument, nullptr,  cli_option_seed          },
     { "help",           no_argument,       nullptr,  cli_option_help          },
     { nullptr,          0,                 nullptr,  0                        }
 };
@@ -86,6 +115,43 @@ parse_arguments(int argc, char* argv[])
                 g_screen_height = (int)strtol(optarg, nullptr, 10);
                 break;
 
+            case cli_option_benchmark:
+                g_benchmark = optarg;
+                break;
+
+            case cli_option_latency:
+                g_latency = true;
+                break;
+
+            case cli_option_xcb:
+                g_xcb = true;
+                break;
+
+            case cli_option_record:
+                g_record = optarg;
+                break;
+
+            case cli_option_replay:
+                g_replay = optarg;
+                break;
+
+            case cli_option_unthrottled:
+                g_unthrottled = true;
+                break;
+
+            case cli_option_frame_digests:
+                g_frame_digests = optarg;
+                break;
+
+            case cli_option_dump_frames:
+                g_dump_frames = optarg;
+                break;
+
+            case cli_option_seed:
+                g_seed = strtoull(optarg, nullptr, 10);
+                g_seed_set = true;
+                break;
+
             case 'h':
             case cli_option_help:
                 g_help = true;
@@ -111,7 +177,21 @@ print_help()
     ss << " -f --fullscreen-games   Fullscreen mode" << std::endl;
     ss << "    --screen-width=INT   Screen width (default " << default_screen_width << ")" << std::endl;
     ss << "    --screen-height=INT  Screen height (default " << default_screen_height << ")" << std::endl;
+    ss << "    --benchmark=NAME     Run micro benchmark and exit" << std::endl;
+    ss << "    --latency            Report input to screen latency on exit" << std::endl;
+    ss << "    --xcb                Use the XCB screen backend" << std::endl;
+    ss << "    --record=FILE        Record input to FILE" << std::endl;
+    ss << "    --replay=FILE        Replay recorded input without a display and exit" << std::endl;
+    ss << "    --unthrottled        Replay as fast as possible" << std::endl;
+    ss << "    --frame-digests=FILE Write a hash of each replayed frame to FILE" << std::endl;
+    ss << "    --dump-frames=DIR    Write each replayed frame to DIR as PNG" << std::endl;
+    ss << "    --seed=INT           Random seed, repeats the tasks of an earlier run" << std::endl;
     ss << " -h --help               Show this help screen" << std::endl;
+    ss << std::endl;
+    ss << "Benchmarks:" << std::endl;
+    for (auto&& name : benchmark_names()) {
+        ss << "    " << name << std::endl;
+    }
     // clang-format on
 
     std::cout << ss.str() << std::flush;
@@ -132,10 +212,40 @@ int main(int argc, char* argv[])
         return EXIT_SUCCESS;
     }
 
+#ifndef DINO_MATH_XCB
+    if (g_xcb) {
+        std::cerr << "Built without XCB support (cmake -DDINO_MATH_XCB=ON)" << std::endl;
+        return EXIT_FAILURE;
+    }
+#endif
+
+    // Micro benchmarks (no display needed, except screen)
+    if (!g_benchmark.empty()) {
+        if (!run_benchmark(g_benchmark)) {
+            std::cerr << "Unknown benchmark: " << g_benchmark << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
     auto game = dino_math(g_screen_width,
                           g_screen_height,
-                          g_fullscreen);
+                          g_fullscreen,
+                          g_latency);
 
+    // Headless, no display needed
+    if (!g_replay.empty()) {
+        game.dump_frames(g_dump_frames);
+        return game.replay(g_replay, g_unthrottled, g_frame_digests) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (g_seed_set) {
+        game.set_seed(g_seed);
+    }
+    if (!g_record.empty()) {
+        game.record_input(g_record);
+    }
+    game.use_xcb(g_xcb);
     game.run();
 
     return 0;
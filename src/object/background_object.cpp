@@ -18,6 +18,7 @@
  */
 
 #include <object/background_object.hpp>
+#include <profiler.hpp>
 
 background_object::background_object(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache, double x, double y, double width, double height)
  : object(ctx, sur_cache, x, y, width, height)
@@ -35,6 +36,8 @@ void background_object::set_bg(double r, double g, double b)
 
 void background_object::draw()
 {
+    PROFILE_ZONE("background_object::draw");
+
     if (!state_changed()) {
         return;
     }
@@ -52,8 +55,13 @@ void background_object::draw()
     state_.invalidate = false;
 }
 
-void background_object::draw(ui_event ev)
+void background_object::draw(const ui_event& ev)
 {
 
 }
 
+rect background_object::bounds()
+{
+    return { 0, 0, ref_width, ref_height };
+}
+
@@ -17,7 +17,11 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include <object/dashed_line_object.hpp>
+#include <profiler.hpp>
 
 dashed_line_object::dashed_line_object(std::shared_ptr<rendering_context> ctx,
                           std::shared_ptr<surface_cache> sur_cache,
@@ -44,25 +48,21 @@ dashed_line_object::dashed_line_object(std::shared_ptr<rendering_context> ctx,
         
 void dashed_line_object::internal_draw()
 {
-    double* dashes = static_cast<double*>(calloc(dashes_.size(), sizeof(double)));
-
-    size_t idx = 0;
-    for(auto&& d : dashes_) {
-        dashes[idx++] = d;
-    }
-
     ctx_->set_source_rgb(r_, g_, b_);
     ctx_->line_width(width_);
-    ctx_->set_dash(dashes, dashes_.size(), dash_offset_);
+    ctx_->set_dash(dashes_.data(), static_cast<int>(dashes_.size()), dash_offset_);
     ctx_->move_to(start_coord_.x, start_coord_.y);
     ctx_->line_to(end_coord_.x, end_coord_.y);
     ctx_->stroke();
 
-    free(dashes);
+    // Solid lines for whatever is stroked next
+    ctx_->set_dash(nullptr, 0, 0);
 }
 
 void dashed_line_object::draw()
 {
+    PROFILE_ZONE("dashed_line_object::draw");
+
     if (!state_changed()) {
         return;
     }
@@ -72,8 +72,10 @@ void dashed_line_object::draw()
     state_.invalidate = false;
 }
 
-void dashed_line_object::draw(ui_event ev)
+void dashed_line_object::draw(const ui_event& ev)
 {
+    PROFILE_ZONE("dashed_line_object::draw(ev)");
+
     if (!state_changed()) {
         return;
     }
@@ -83,3 +85,13 @@ void dashed_line_object::draw(ui_event ev)
     state_.invalidate = false;
 }
 
+rect dashed_line_object::bounds()
+{
+    auto x = std::min(start_coord_.x, end_coord_.x);
+    auto y = std::min(start_coord_.y, end_coord_.y);
+
+    return { x - width_ / 2,
+             y - width_ / 2,
+             std::abs(end_coord_.x - start_coord_.x) + width_,
+             std::abs(end_coord_.y - start_coord_.y) + width_ };
+}
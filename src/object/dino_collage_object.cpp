@@ -19,12 +19,23 @@
 
 #include <cmath>
 #include <algorithm>
-#include <random>
+#include <functional>
+#include <thread>
 
 #include <object/dino_collage_object.hpp>
+#include <profiler.hpp>
+#include <random_generator.hpp>
+
+// Collages with at least this many dinos are composed from a thumbnail atlas
+constexpr int atlas_min_dinos = 16;
+
+// Collages with at least this many dinos are filled by several threads
+constexpr int parallel_min_dinos = 128;
+constexpr int max_fill_threads = 4;
 
 dino_collage_object::dino_collage_object(std::shared_ptr<rendering_context> ctx,
                             std::shared_ptr<surface_cache> sur_cache,
+                            std::shared_ptr<collage_cache> col_cache,
                             double x,
                             double y,
                             double width,
@@ -32,38 +43,106 @@ dino_collage_object::dino_collage_object(std::shared_ptr<rendering_context> ctx,
                             std::vector<std::string> selected_svg_paths,
                             int nr_dinos)
     : object(ctx, sur_cache, x, y, width, height)
-    , selected_svg_paths_(selected_svg_paths)
+    , col_cache_(col_cache)
     , nr_dinos_(nr_dinos)
 {
+    set_selected_svg_paths(selected_svg_paths);
+
     // Allocate top level surface
-    surface_ = std::shared_ptr<surface>(new surface(ctx_->scale(width), ctx_->scale(height)));
+    surface_ = std::shared_ptr<surface>(new surface(ctx_->scale(width), ctx_->scale(height), true));
     surface_->load_background(0, 0, 0);
 }
 
-grid dino_collage_object::generate_collage(grid grid_setup)
+grid dino_collage_object::fit_grid(int nr_dinos, grid grid_setup)
 {
-    // Clear previous surface
-    surface_->fill(0,0,0);
-
-    if (nr_dinos_ == 0) {
-        return grid_setup;
-    }
-
     // Determine suitable grid
-    if (grid_setup.nr_cols == 0 || grid_setup.nr_rows == 0) {
+    if (nr_dinos > 0 && (grid_setup.nr_cols == 0 || grid_setup.nr_rows == 0)) {
         constexpr int min_cols = 2;
-        grid_setup.nr_cols = ceil(sqrt(static_cast<double>(nr_dinos_)));
+        grid_setup.nr_cols = ceil(sqrt(static_cast<double>(nr_dinos)));
         if (grid_setup.nr_cols < min_cols) {
             grid_setup.nr_cols = min_cols;
         }
 
-        grid_setup.nr_rows = ceil(static_cast<double>(nr_dinos_) / static_cast<double>(grid_setup.nr_cols));
+        grid_setup.nr_rows = ceil(static_cast<double>(nr_dinos) / static_cast<double>(grid_setup.nr_cols));
+    }
+
+    return grid_setup;
+}
+
+std::shared_ptr<surface> dino_collage_object::build_collage(int nr_dinos, grid grid_setup, uint32_t seed)
+{
+    PROFILE_ZONE("dino_collage_object::build_collage");
+
+    grid_setup = fit_grid(nr_dinos, grid_setup);
+
+    collage_key key;
+    key.selection_id = selection_id_;
+    key.nr_dinos = nr_dinos;
+    key.nr_cols = nr_dinos > 0 ? grid_setup.nr_cols : 0;
+    key.nr_rows = nr_dinos > 0 ? grid_setup.nr_rows : 0;
+    key.width = static_cast<int>(ctx_->scale(state_.width));
+    key.height = static_cast<int>(ctx_->scale(state_.height));
+    key.seed = seed;
+
+    auto collage = col_cache_->get(key);
+    if (collage == nullptr) {
+        collage = render_collage(nr_dinos, grid_setup, seed);
+        collage->set_immutable();
+        col_cache_->put(key, collage);
     }
+
+    return collage;
+}
+
+std::shared_ptr<surface> dino_collage_object::render_collage(int nr_dinos, grid grid_setup, uint32_t seed)
+{
+    PROFILE_ZONE("dino_collage_object::render_collage");
+
+    // Cached collages are shared, always render into a new surface. Dinos
+    // are drawn onto black, the collage itself is opaque.
+    auto collage = std::shared_ptr<surface>(new surface(ctx_->scale(state_.width), ctx_->scale(state_.height), true));
+    collage->load_background(0, 0, 0);
+
+    if (nr_dinos == 0 || selected_svg_paths_.empty()) {
+        return collage;
+    }
+
     double aspect_ratio = state_.width / state_.height;
 
     double thumbnail_width  = floor(ctx_->scale(state_.width) / static_cast<double>(grid_setup.nr_cols));
     double thumbnail_height = floor(thumbnail_width / aspect_ratio);
 
+    // Pick a dino for every cell up front
+    random_generator rng(seed);
+    int last_index = static_cast<int>(selected_svg_paths_.size()) - 1;
+
+    std::vector<int> indices;
+    indices.reserve(nr_dinos);
+    for(int i=0; i < nr_dinos && i < grid_setup.nr_cols * grid_setup.nr_rows; i++) {
+        indices.emplace_back(rng.uniform(0, last_index));
+    }
+
+    if (nr_dinos >= atlas_min_dinos && thumbnail_width >= 1 && thumbnail_height >= 1) {
+        // High count: compose from the thumbnail atlas
+        if (atlas_ == nullptr ||
+            atlas_selection_id_ != selection_id_ ||
+            atlas_->thumbnail_width() != static_cast<int>(thumbnail_width) ||
+            atlas_->thumbnail_height() != static_cast<int>(thumbnail_height)) {
+            atlas_ = std::make_shared<thumbnail_atlas>(sur_cache_, selected_svg_paths_,
+                                                       static_cast<int>(thumbnail_width),
+                                                       static_cast<int>(thumbnail_height));
+            atlas_selection_id_ = selection_id_;
+        }
+
+        int nr_threads = 1;
+        if (nr_dinos >= parallel_min_dinos) {
+            nr_threads = std::min(max_fill_threads, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+
+        atlas_->compose(collage, indices, grid_setup.nr_cols, nr_threads);
+        return collage;
+    }
+
     std::vector<std::shared_ptr<surface>> dino_surfaces;
     for(auto&& svg_path : selected_svg_paths_) {
         auto s = sur_cache_->get_svg_surface(svg_path, thumbnail_width, thumbnail_height);
@@ -71,37 +150,30 @@ grid dino_collage_object::generate_collage(grid grid_setup)
     }
 
     // Populate grid
-    int path_idx = 0;
+    size_t cell = 0;
     double y_offset = 0;
     for(int y=0; y < grid_setup.nr_rows; y++) {
         double x_offset = 0;
-        for(int x=0; x < grid_setup.nr_cols; x++, path_idx) {
-            if (path_idx < nr_dinos_) {
-                //printf("y_offset %lf x_offset %lf w %lf h %lf\n", y_offset, x_offset, thumbnail_width, thumbnail_height);
-                std::random_device rd;
-                std::uniform_int_distribution<int> dist(0, dino_surfaces.size()-1);
-                int rnd_idx = dist(rd);
-                surface_->draw_surface(dino_surfaces[rnd_idx], x_offset, y_offset, 1.0);
+        for(int x=0; x < grid_setup.nr_cols; x++) {
+            if (cell < indices.size()) {
+                collage->draw_surface(dino_surfaces[indices[cell]], x_offset, y_offset, 1.0);
             }
 
             x_offset += thumbnail_width;
-            path_idx++;
+            cell++;
         }
 
         y_offset += thumbnail_height;
     }
 
-    return grid_setup;
+    return collage;
 }
 
-grid dino_collage_object::set_nr_dinos(int nr_dinos, grid grid_setup)
+void dino_collage_object::set_collage(int nr_dinos, std::shared_ptr<surface> collage)
 {
     nr_dinos_ = nr_dinos;
-    
-    auto used_grid = generate_collage(grid_setup);
+    surface_ = collage;
     invalidate();
-
-    return used_grid;
 }
 
 int dino_collage_object::nr_dinos()
@@ -111,6 +183,8 @@ int dino_collage_object::nr_dinos()
 
 void dino_collage_object::draw()
 {
+    PROFILE_ZONE("dino_collage_object::draw");
+
     if (!state_changed()) {
         return;
     }
@@ -129,8 +203,10 @@ void dino_collage_object::draw()
     state_.invalidate = false;
 }
 
-void dino_collage_object::draw(ui_event ev)
+void dino_collage_object::draw(const ui_event& ev)
 {
+    PROFILE_ZONE("dino_collage_object::draw(ev)");
+
     if (!state_changed()) {
         return;
     }
@@ -158,4 +234,10 @@ void dino_collage_object::set_visibility(bool visible)
 void dino_collage_object::set_selected_svg_paths(std::vector<std::string>& selected_svg_paths)
 {
     selected_svg_paths_ = selected_svg_paths;
+
+    // Identifies the selection in collage cache keys
+    selection_id_ = 0;
+    for(auto&& path : selected_svg_paths_) {
+        selection_id_ = selection_id_ * 31 + std::hash<std::string>{}(path);
+    }
 }
@@ -17,11 +17,18 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>
  */
 
+#include <cmath>
+
 #include <object/dino_object.hpp>
+#include <profiler.hpp>
 
 constexpr double highlight_on = 0.0;
 constexpr double highlight_off = 0.2;
 
+// Cleared around the image, font rendering may touch outside pixels
+constexpr double margin_left = 5;
+constexpr double name_height = 60;
+
 dino_object::dino_object(std::shared_ptr<rendering_context> ctx,
                          std::shared_ptr<surface_cache> sur_cache,
                          double x,
@@ -38,6 +45,9 @@ dino_object::dino_object(std::shared_ptr<rendering_context> ctx,
         surface_ = sur_cache_->get_svg_surface(svg_path,
                                             ctx_->scale(width),
                                             ctx_->scale(height));
+        mask_ = sur_cache_->get_svg_mask(svg_path,
+                                         ctx_->scale(width),
+                                         ctx_->scale(height));
         state_.alpha = highlight_on;
 
         checkmark_surface_ = sur_cache_->get_svg_surface("/usr/share/dino_math/images/Checkmark.svg",
@@ -50,13 +60,31 @@ void dino_object::internal_draw()
 {
     state_.invalidate = false;
 
-    // Draw a bit outside since font
-    // rendering may touch outside pixels
+    paint(hover_, state_.alpha);
+}
+
+void dino_object::draw_resting()
+{
+    PROFILE_ZONE("dino_object::draw_resting");
+
+    paint(false, resting_alpha());
+}
+
+bool dino_object::is_resting()
+{
+    return !hover_ && state_.alpha == resting_alpha();
+}
+
+double dino_object::resting_alpha()
+{
+    return selected_ ? highlight_on : highlight_off;
+}
+
+void dino_object::paint(bool hover, double alpha)
+{
+    auto r = bounds();
     ctx_->set_source_rgb(0,0,0);
-    ctx_->rectangle(state_.x - 5,
-                    state_.y,
-                    state_.width + 5,
-                    state_.height + 60);
+    ctx_->rectangle(r.x, r.y, r.width, r.height);
     ctx_->fill();
 
     if (surface_ == nullptr) {
@@ -64,14 +92,14 @@ void dino_object::internal_draw()
     }
 
     ctx_->draw_surface(surface_, state_.x, state_.y, 1);
-    ctx_->set_source_rgba(0,0,0,state_.alpha);
+    ctx_->set_source_rgba(0,0,0,alpha);
     ctx_->rectangle(state_.x,
                     state_.y,
                     state_.width,
                     state_.height);
     ctx_->fill();
 
-    if (hover_ || selected_) {
+    if (hover || selected_) {
         ctx_->move_to(state_.x, state_.y + state_.height + 20);
         ctx_->set_source_rgb(1.0, 0.834, 0.168);
         ctx_->font_size(25);
@@ -87,6 +115,21 @@ void dino_object::internal_draw()
 
 void dino_object::draw()
 {
+    PROFILE_ZONE("dino_object::draw");
+
+    if (!state_changed()) {
+        return;
+    }
+
+    internal_draw();
+}
+
+void dino_object::draw(const ui_event& ev)
+{
+    PROFILE_ZONE("dino_object::draw(ev)");
+
+    update(ev);
+
     if (!state_changed()) {
         return;
     }
@@ -94,16 +137,18 @@ void dino_object::draw()
     internal_draw();
 }
 
-void dino_object::draw(ui_event ev)
+bool dino_object::update(const ui_event& ev)
 {
-    bool updated = false;
+    auto prev_alpha = state_.alpha;
+    auto prev_hover = hover_;
+    auto prev_selected = selected_;
+
     if (intersect(static_cast<double>(ev.get_x()),
                   static_cast<double>(ev.get_y()))) {
         state_.alpha = highlight_on;
         hover_ = true;
         if (ev.get_button_state() == button::left) {
             selected_ = !selected_;
-            updated = true;
         }
 
     } else {
@@ -113,11 +158,32 @@ void dino_object::draw(ui_event ev)
         }
     }
 
-    if (!state_changed() && !updated) {
-        return;
+    if (state_.alpha == prev_alpha && hover_ == prev_hover && selected_ == prev_selected) {
+        return false;
     }
 
-    internal_draw();
+    invalidate();
+    return true;
+}
+
+bool dino_object::intersect(double mouse_x, double mouse_y)
+{
+    if (!object::intersect(mouse_x, mouse_y)) {
+        return false;
+    }
+
+    if (mask_ == nullptr) {
+        return true;
+    }
+
+    // Surface pixels, the image is drawn unscaled at state_.x, state_.y
+    return mask_->covers(static_cast<int>(floor(ctx_->scale(mouse_x - state_.x))),
+                         static_cast<int>(floor(ctx_->scale(mouse_y - state_.y))));
+}
+
+rect dino_object::bounds()
+{
+    return { state_.x - margin_left, state_.y, state_.width + margin_left, state_.height + name_height };
 }
 
 bool dino_object::is_selected()
@@ -0,0 +1,86 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <object/dirty_list.hpp>
+#include <object/object.hpp>
+
+void dirty_list::add(object* obj)
+{
+    obj->dirty_list_ = this;
+    obj->z_ = static_cast<int>(objects_.size());
+    objects_.emplace_back(obj);
+
+    if (obj->state_.invalidate) {
+        push(obj);
+    }
+}
+
+void dirty_list::damage(const rect& r)
+{
+    for(auto&& obj : objects_) {
+        if (!obj->dirty_queued_ && overlaps(r, obj->bounds())) {
+            obj->invalidate();
+        }
+    }
+}
+
+void dirty_list::push(object* obj)
+{
+    if (obj->dirty_queued_) {
+        return;
+    }
+
+    // A handful of objects per scene, a sorted insert is cheap
+    auto link = &head_;
+    while (*link != nullptr && (*link)->z_ <= obj->z_) {
+        link = &(*link)->dirty_next_;
+    }
+
+    obj->dirty_next_ = *link;
+    obj->dirty_queued_ = true;
+    *link = obj;
+}
+
+void dirty_list::draw()
+{
+    // Objects found here have a higher z and are inserted after the one
+    // looked at, so they get checked as well
+    for(auto obj = head_; obj != nullptr; obj = obj->dirty_next_) {
+        auto r = obj->bounds();
+        for(size_t i = obj->z_ + 1; i < objects_.size(); i++) {
+            auto above = objects_[i];
+            if (!above->dirty_queued_ && overlaps(r, above->bounds())) {
+                above->invalidate();
+                object::overlap_count_++;
+            }
+        }
+    }
+
+    auto obj = head_;
+    head_ = nullptr;
+
+    while (obj != nullptr) {
+        auto next = obj->dirty_next_;
+        obj->dirty_next_ = nullptr;
+        obj->dirty_queued_ = false;
+
+        obj->draw();
+        obj = next;
+    }
+}
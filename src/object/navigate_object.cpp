@@ -19,6 +19,7 @@
 
 #include <object/navigate_object.hpp>
 #include <common.hpp>
+#include <profiler.hpp>
 
 constexpr double highlight_on = 0.0;
 constexpr double highlight_off = 0.2;
@@ -39,6 +40,8 @@ navigate_object::navigate_object(std::shared_ptr<rendering_context> ctx,
 
 void navigate_object::draw()
 {
+    PROFILE_ZONE("navigate_object::draw");
+
     if (!state_changed()) {
         return;
     }
@@ -46,20 +49,28 @@ void navigate_object::draw()
     internal_draw();
 }
 
-void navigate_object::draw(ui_event ev)
+void navigate_object::draw(const ui_event& ev)
 {
+    PROFILE_ZONE("navigate_object::draw(ev)");
+
+    update(ev);
+}
+
+bool navigate_object::update(const ui_event& ev)
+{
+    auto prev_alpha = state_.alpha;
     bool updated = false;
     if (intersect(static_cast<double>(ev.get_x()),
                   static_cast<double>(ev.get_y()))) {
         state_.alpha = highlight_on;
         hover_ = true;
         if (ev.get_button_state() == button::left) {
-            auto elapsed_time = (get_ts() - selected_ts_) / 1000; // unit: ms
+            auto elapsed_time = (get_game_ts() - selected_ts_) / 1000; // unit: ms
             if (elapsed_time > 100 && nav_state_ != navigation_state::continue_blocked) {
                 selected_ = !selected_;
                 updated = true;
                 if (selected_) {
-                    selected_ts_ = get_ts();
+                    selected_ts_ = get_game_ts();
                 }
             }
         }
@@ -71,11 +82,13 @@ void navigate_object::draw(ui_event ev)
         }
     }
 
-    if (!state_changed() && !updated) {
-        return;
+    if (state_.alpha == prev_alpha && !updated) {
+        return false;
     }
 
-    internal_draw();
+    // Drawn by draw() from the dirty list
+    invalidate();
+    return true;
 }
 
 void navigate_object::change_state(navigation_state nav_state)
@@ -17,25 +17,34 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>
  */
 
+#include <object/dirty_list.hpp>
 #include <object/object.hpp>
 
+uint64_t object::visit_count_ = 0;
+uint64_t object::redraw_count_ = 0;
+uint64_t object::overlap_count_ = 0;
+
  object::object(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache, double x, double y, double width, double height)
   : ctx_(ctx)
   , sur_cache_(sur_cache)
 {
     state_.x = x;
     state_.y = y;
+    state_.angle = 0;
     state_.width = width;
     state_.height = height;
     state_.alpha = 1.0;
     state_.invalidate = true;
 }
 
+rect object::bounds()
+{
+    return { state_.x, state_.y, state_.width, state_.height };
+}
+
 bool object::intersect(object& obj)
 {
-    return false;
-    //return ((x_ >= obj.x() && x_ <= obj.x() + width_) &&
-      //      (y_ >= obj.y() && y_ <= obj.y() + height_));
+    return overlaps(bounds(), obj.bounds());
 }
 
 bool object::intersect(double mouse_x, double mouse_y)
@@ -44,15 +53,59 @@ bool object::intersect(double mouse_x, double mouse_y)
             (mouse_y >= state_.y && mouse_y <= state_.y + state_.height));
 }
 
+void object::set_x(double x)
+{
+    if (state_.x != x) {
+        state_.x = x;
+        invalidate();
+    }
+}
+
+void object::set_y(double y)
+{
+    if (state_.y != y) {
+        state_.y = y;
+        invalidate();
+    }
+}
+
+void object::set_visibility(bool visible)
+{
+    if (visible_ != visible) {
+        visible_ = visible;
+        invalidate();
+    }
+}
+
+void object::set_angle(double angle)
+{
+    if (state_.angle != angle) {
+        state_.angle = angle;
+        invalidate();
+    }
+}
+
 bool object::state_changed()
 {
-    bool changed = state_.x != prev_state_.x || state_.y != prev_state_.y || state_.angle != prev_state_.angle || state_.alpha != prev_state_.alpha || state_.invalidate == true;
+    visit_count_++;
 
-    prev_state_ = state_;
+    if (state_.invalidate) {
+        redraw_count_++;
+    }
 
-    return changed;
+    return state_.invalidate;
 }
 
+void object::invalidate()
+{
+    state_.invalidate = true;
+
+    if (dirty_list_ != nullptr) {
+        dirty_list_->push(this);
+    }
+}
+
+
 void object::draw_object_bg()
 {
     ctx_->set_source_rgb(0,0,0);
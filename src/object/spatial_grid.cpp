@@ -0,0 +1,66 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <object/object.hpp>
+#include <object/spatial_grid.hpp>
+
+int spatial_grid::col(double x)
+{
+    return std::clamp(static_cast<int>(floor(x / cell_size)), 0, nr_cols - 1);
+}
+
+int spatial_grid::row(double y)
+{
+    return std::clamp(static_cast<int>(floor(y / cell_size)), 0, nr_rows - 1);
+}
+
+void spatial_grid::insert(object* obj)
+{
+    // Inclusive, object::intersect() counts the edges as inside
+    auto first_col = col(obj->x());
+    auto last_col = col(obj->x() + obj->width());
+    auto first_row = row(obj->y());
+    auto last_row = row(obj->y() + obj->height());
+
+    for(int r = first_row; r <= last_row; r++) {
+        for(int c = first_col; c <= last_col; c++) {
+            cells_[r * nr_cols + c].emplace_back(obj);
+        }
+    }
+}
+
+void spatial_grid::clear()
+{
+    // Keeps the capacity, rebuilding does not allocate
+    for(auto&& cell : cells_) {
+        cell.clear();
+    }
+}
+
+const std::vector<object*>& spatial_grid::cell(double x, double y)
+{
+    if (x < 0 || y < 0 || x > ref_width || y > ref_height) {
+        return outside_;
+    }
+
+    return cells_[row(y) * nr_cols + col(x)];
+}
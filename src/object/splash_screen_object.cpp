@@ -18,6 +18,7 @@
  */
 
 #include <object/splash_screen_object.hpp>
+#include <profiler.hpp>
 
 splash_screen_object::splash_screen_object(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache, double x, double y, double width, double height)
  : object(ctx, sur_cache, x, y, width, height)
@@ -34,6 +35,8 @@ splash_screen_object::splash_screen_object(std::shared_ptr<rendering_context> ct
 
 void splash_screen_object::draw()
 {
+    PROFILE_ZONE("splash_screen_object::draw");
+
     if (!state_changed()) {
         return;
     }
@@ -42,7 +45,12 @@ void splash_screen_object::draw()
     state_.invalidate = false;
 }
 
-void splash_screen_object::draw(ui_event ev)
+void splash_screen_object::draw(const ui_event& ev)
 {
 
 }
+
+rect splash_screen_object::bounds()
+{
+    return { 0, 0, state_.width, state_.height };
+}
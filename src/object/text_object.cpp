@@ -18,6 +18,7 @@
  */
 
 #include <object/text_object.hpp>
+#include <profiler.hpp>
 
 text_object::text_object(std::shared_ptr<rendering_context> ctx,
             std::shared_ptr<surface_cache> sur_cache,
@@ -56,15 +57,15 @@ void text_object::set_size(double size)
 
 void text_object::draw()
 {
+    PROFILE_ZONE("text_object::draw");
+
     if (!state_changed()) {
         return;
     }
 
+    auto r = bounds();
     ctx_->set_source_rgb(bg_r_, bg_g_, bg_b_);
-    ctx_->rectangle(state_.x - (str_size_ / 3.1),
-                    state_.y - (str_size_ / 3.1),
-                    state_.width + (str_size_ / 3.1),
-                    state_.height + (str_size_ / 3.1));
+    ctx_->rectangle(r.x, r.y, r.width, r.height);
     ctx_->fill();
 
     ctx_->move_to(state_.x , state_.y + (7 * (str_size_ / 10)));
@@ -75,8 +76,10 @@ void text_object::draw()
     state_.invalidate = false;
 }
 
-void text_object::draw(ui_event ev)
+void text_object::draw(const ui_event& ev)
 {
+    PROFILE_ZONE("text_object::draw(ev)");
+
     if (!state_changed()) {
         return;
     }
@@ -84,3 +87,10 @@ void text_object::draw(ui_event ev)
     state_.invalidate = false;
 }
 
+rect text_object::bounds()
+{
+    return { state_.x - (str_size_ / 3.1),
+             state_.y - (str_size_ / 3.1),
+             state_.width + (str_size_ / 3.1),
+             state_.height + (str_size_ / 3.1) };
+}
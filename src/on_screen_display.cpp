@@ -0,0 +1,225 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+#include <graphics_context/blit.hpp>
+#include <on_screen_display.hpp>
+
+constexpr double osd_font_size = 18;
+constexpr double osd_margin = 8;
+constexpr double osd_graph_height = 40;
+constexpr int glyph_pad = 1; // room for glyphs reaching left of their origin
+
+on_screen_display::on_screen_display(std::shared_ptr<rendering_context> ctx)
+ : ctx_(ctx)
+{
+    for(auto&& panel : panels_) {
+        panel = std::shared_ptr<surface>(new surface(ceil(ctx_->scale(panel_width)), ceil(ctx_->scale(panel_height)), true));
+        panel->load_background(0, 0, 0);
+    }
+
+    build_glyph_atlas();
+}
+
+void on_screen_display::build_glyph_atlas()
+{
+    // Measure with a scratch surface
+    auto scratch = std::shared_ptr<surface>(new surface(1, 1));
+    scratch->load_transparent();
+
+    auto cr = scratch->cr();
+    cairo_select_font_face(cr, "Lato Black", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, ctx_->scale(osd_font_size));
+
+    cairo_font_extents_t font_extents;
+    cairo_font_extents(cr, &font_extents);
+
+    int max_width = 0;
+    char str[2] = { 0, 0 };
+    for(int i = 0; i < nr_glyphs; i++) {
+        str[0] = static_cast<char>(first_glyph + i);
+        cairo_text_extents_t extents;
+        cairo_text_extents(cr, str, &extents);
+        glyph_advance_[i] = static_cast<int>(lround(extents.x_advance));
+        max_width = std::max(max_width, static_cast<int>(ceil(extents.x_bearing + extents.width)));
+    }
+
+    glyph_cell_width_ = std::max(max_width, *std::max_element(glyph_advance_.begin(), glyph_advance_.end())) + 2 * glyph_pad;
+    glyph_height_ = static_cast<int>(ceil(font_extents.ascent + font_extents.descent));
+    line_height_ = static_cast<int>(ceil(font_extents.height));
+
+    // One cell per glyph, side by side
+    glyphs_ = std::shared_ptr<surface>(new surface(glyph_cell_width_ * nr_glyphs, glyph_height_));
+    glyphs_->load_transparent();
+
+    cr = glyphs_->cr();
+    cairo_select_font_face(cr, "Lato Black", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, ctx_->scale(osd_font_size));
+    cairo_set_source_rgb(cr, 1.0, 0.834, 0.168);
+
+    for(int i = 0; i < nr_glyphs; i++) {
+        str[0] = static_cast<char>(first_glyph + i);
+        cairo_move_to(cr, i * glyph_cell_width_ + glyph_pad, font_extents.ascent);
+        cairo_show_text(cr, str);
+    }
+
+    cairo_surface_flush(glyphs_->handle());
+}
+
+void on_screen_display::add_frame_time(int64_t frame_time)
+{
+    frame_times_[frame_time_head_ % osd_graph_samples] = frame_time;
+    frame_time_head_++;
+}
+
+void on_screen_display::draw_text(int x, int y, const char* str)
+{
+    auto& k = blit_best_kernels();
+    auto dst = panel_->handle();
+    auto dst_data = cairo_image_surface_get_data(dst);
+    auto dst_stride = cairo_image_surface_get_stride(dst);
+    auto dst_width = cairo_image_surface_get_width(dst);
+    auto dst_height = cairo_image_surface_get_height(dst);
+    auto glyph_data = cairo_image_surface_get_data(glyphs_->handle());
+    auto glyph_stride = cairo_image_surface_get_stride(glyphs_->handle());
+
+    int h = std::min(glyph_height_, dst_height - y);
+    for(auto c = str; *c != 0 && h > 0; c++) {
+        int i = static_cast<unsigned char>(*c) - first_glyph;
+        if (i < 0 || i >= nr_glyphs) {
+            i = '?' - first_glyph;
+        }
+
+        int cell_x = x - glyph_pad;
+        int w = std::min(glyph_cell_width_, dst_width - cell_x);
+        if (cell_x < 0 || w <= 0) {
+            break;
+        }
+
+        blit_over(k,
+                  dst_data + y * dst_stride + cell_x * 4, dst_stride,
+                  glyph_data + i * glyph_cell_width_ * 4, glyph_stride,
+                  w, h);
+        x += glyph_advance_[i];
+    }
+}
+
+void on_screen_display::draw_graph(int x, int y, int width, int height, double target_fps)
+{
+    auto& k = blit_best_kernels();
+    auto dst = panel_->handle();
+    auto dst_data = cairo_image_surface_get_data(dst);
+    auto dst_stride = cairo_image_surface_get_stride(dst);
+
+    static const uint32_t graph_bg = blit_rgb(0.1, 0.1, 0.1);
+    static const uint32_t bar_ok = blit_rgb(0.3, 0.8, 0.3);
+    static const uint32_t bar_slow = blit_rgb(0.9, 0.25, 0.25);
+    static const uint32_t budget_line = blit_rgb(1.0, 0.834, 0.168);
+
+    blit_fill(k, dst_data + y * dst_stride + x * 4, dst_stride, width, height, graph_bg);
+
+    // Full height: two frame periods. The line marks one frame period.
+    double budget = 1000000.0 / target_fps;
+    double full_scale = 2 * budget;
+    int bar_width = std::max(1, width / osd_graph_samples);
+
+    size_t nr_samples = std::min<size_t>(frame_time_head_, osd_graph_samples);
+    for(size_t i = 0; i < nr_samples; i++) {
+        auto frame_time = frame_times_[(frame_time_head_ - nr_samples + i) % osd_graph_samples];
+        int bar_height = static_cast<int>(std::min(1.0, static_cast<double>(frame_time) / full_scale) * height);
+        if (bar_height <= 0) {
+            continue;
+        }
+
+        int bar_x = x + static_cast<int>(i) * bar_width;
+        blit_fill(k, dst_data + (y + height - bar_height) * dst_stride + bar_x * 4, dst_stride,
+                  std::max(1, bar_width - 1), bar_height,
+                  frame_time > budget ? bar_slow : bar_ok);
+    }
+
+    blit_fill(k, dst_data + (y + height / 2) * dst_stride + x * 4, dst_stride, width, 1, budget_line);
+}
+
+void on_screen_display::draw(const osd_values& values)
+{
+    auto& k = blit_best_kernels();
+    panel_ = panels_[frame_++ % panels_.size()];
+    auto handle = panel_->handle();
+
+    // Hands a copy to recordings still queued with this panel
+    cairo_surface_flush(handle);
+
+    blit_fill(k, cairo_image_surface_get_data(handle), cairo_image_surface_get_stride(handle),
+              cairo_image_surface_get_width(handle), cairo_image_surface_get_height(handle),
+              blit_rgb(0, 0, 0));
+
+    int margin = static_cast<int>(ctx_->scale(osd_margin));
+    int y = margin;
+
+    auto elapsed_time = values.elapsed_time / 1000000; // unit: s
+    snprintf(line_, sizeof(line_), "FPS %d  elapsed %03ld:%02ld:%02ld:%02ld",
+             static_cast<int>(values.fps),
+             static_cast<long>(elapsed_time / (3600 * 24)),
+             static_cast<long>(elapsed_time / 3600 % 24),
+             static_cast<long>(elapsed_time / 60 % 60),
+             static_cast<long>(elapsed_time % 60));
+    draw_text(margin, y, line_);
+    y += line_height_;
+
+    if (values.frame_times != nullptr) {
+        auto& h = *values.frame_times;
+        snprintf(line_, sizeof(line_), "Frame p50 %.2f p95 %.2f p99 %.2f max %.2f ms",
+                 static_cast<double>(h.percentile(50)) / 1000.0,
+                 static_cast<double>(h.percentile(95)) / 1000.0,
+                 static_cast<double>(h.percentile(99)) / 1000.0,
+                 static_cast<double>(h.max()) / 1000.0);
+        draw_text(margin, y, line_);
+    }
+    y += line_height_;
+
+    auto& cs = values.cache_stats;
+    auto lookups = cs.hits + cs.misses;
+    snprintf(line_, sizeof(line_), "Cache %.1f%% hit  %zu entries  %.1f MB  %d pending",
+             lookups > 0 ? 100.0 * static_cast<double>(cs.hits) / static_cast<double>(lookups) : 0.0,
+             cs.entries,
+             static_cast<double>(cs.resident_bytes) / (1024.0 * 1024.0),
+             cs.pending_loads);
+    draw_text(margin, y, line_);
+    y += line_height_;
+
+    snprintf(line_, sizeof(line_), "Redrawn %lu of %lu visited objects, %lu overlapped",
+             static_cast<unsigned long>(values.redraws),
+             static_cast<unsigned long>(values.visits),
+             static_cast<unsigned long>(values.overlaps));
+    draw_text(margin, y, line_);
+    y += line_height_ + margin / 2;
+
+    int graph_width = cairo_image_surface_get_width(handle) - 2 * margin;
+    int graph_height = std::min(static_cast<int>(ctx_->scale(osd_graph_height)),
+                                cairo_image_surface_get_height(handle) - y - margin);
+    if (graph_height > 0) {
+        draw_graph(margin, y, graph_width, graph_height, values.target_fps);
+    }
+
+    cairo_surface_mark_dirty(handle);
+    ctx_->draw_surface(panel_, 0, 0, 1.0);
+}
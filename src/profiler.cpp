@@ -0,0 +1,175 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <profiler.hpp>
+
+#ifdef DINO_MATH_PROFILER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <common.hpp>
+
+constexpr size_t profile_ring_size = 1 << 16; // zones per thread
+
+struct profile_record
+{
+    const char* name;
+    int64_t begin_ts; // unit: ns
+    int64_t end_ts;   // unit: ns
+    int tid;
+};
+
+// Written by its owning thread only. The exporter reads it after the frame
+// loop has stopped.
+struct profile_ring
+{
+    std::atomic<uint64_t> head{0};
+    std::vector<profile_record> records;
+    bool in_use{false};
+};
+
+static std::mutex rings_mutex;
+static std::vector<std::shared_ptr<profile_ring>> rings;
+
+// Hands the ring on to the next new thread when this one exits. Short
+// lived workers (e.g. collage fill threads) do not grow the ring list.
+struct profile_ring_owner
+{
+    profile_ring* ring{nullptr};
+    int tid{0};
+
+    ~profile_ring_owner()
+    {
+        if (ring != nullptr) {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            ring->in_use = false;
+        }
+    }
+};
+
+static profile_ring_owner& thread_ring()
+{
+    thread_local profile_ring_owner owner;
+    if (owner.ring == nullptr) {
+        owner.tid = static_cast<int>(syscall(SYS_gettid));
+
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for(auto&& r : rings) {
+            if (!r->in_use) {
+                owner.ring = r.get();
+                break;
+            }
+        }
+
+        if (owner.ring == nullptr) {
+            auto r = std::make_shared<profile_ring>();
+            r->records.resize(profile_ring_size);
+            rings.emplace_back(r);
+            owner.ring = r.get();
+        }
+        owner.ring->in_use = true;
+    }
+
+    return owner;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+profile_zone::profile_zone(const char* name)
+ : name_(name)
+ , begin_ts_(get_ts_ns())
+{
+}
+
+profile_zone::~profile_zone()
+{
+    auto& owner = thread_ring();
+    auto ring = owner.ring;
+    auto head = ring->head.load(std::memory_order_relaxed);
+    ring->records[head % profile_ring_size] = { name_, begin_ts_, get_ts_ns(), owner.tid };
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+static void write_json_string(FILE* f, const char* str)
+{
+    fputc('"', f);
+    for(auto c = str; *c != 0; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', f);
+        }
+        fputc(*c, f);
+    }
+    fputc('"', f);
+}
+
+void profiler_write_trace(const char* path)
+{
+    auto env_path = getenv("DINO_MATH_TRACE");
+    if (env_path != nullptr) {
+        path = env_path;
+    }
+
+    auto f = fopen(path, "w");
+    if (f == nullptr) {
+        perror(path);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(rings_mutex);
+
+    int pid = static_cast<int>(getpid());
+    size_t nr_zones = 0;
+    bool first = true;
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    for(auto&& ring : rings) {
+        auto head = ring->head.load(std::memory_order_acquire);
+        auto count = std::min<uint64_t>(head, profile_ring_size);
+
+        // Oldest surviving record first
+        for(auto i = head - count; i < head; i++) {
+            auto& r = ring->records[i % profile_ring_size];
+            fprintf(f, "%s{\"name\":", first ? "" : ",\n");
+            write_json_string(f, r.name);
+            fprintf(f, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                    static_cast<double>(r.begin_ts) / 1000.0,
+                    static_cast<double>(r.end_ts - r.begin_ts) / 1000.0,
+                    pid, r.tid);
+            first = false;
+            nr_zones++;
+        }
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(f);
+
+    printf("Profiler: %zu zones written to %s\n", nr_zones, path);
+}
+
+#endif
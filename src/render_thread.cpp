@@ -0,0 +1,248 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <common.hpp>
+#include <profiler.hpp>
+#include <render_thread.hpp>
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+render_thread::render_thread(std::shared_ptr<screen> screen)
+ : screen_(screen)
+{
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    done_fd_ = eventfd(0, EFD_CLOEXEC);
+
+    thread_ = std::thread(&render_thread::run, this);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+render_thread::~render_thread()
+{
+    stop();
+
+    close(wake_fd_);
+    close(done_fd_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+render_thread::submit(frame_snapshot&& frame)
+{
+    frame.submit_ts = get_ts();
+
+    while (!queue_.push(std::move(frame))) {
+        // Renderer is render_queue_size frames behind. Frames are deltas
+        // on top of the previous ones and cannot be dropped.
+        queue_full_waits_++;
+        uint64_t value;
+        if (read(done_fd_, &value, sizeof(value)) != sizeof(value)) {
+            perror("eventfd read");
+            return;
+        }
+    }
+
+    uint64_t value = 1;
+    if (write(wake_fd_, &value, sizeof(value)) != sizeof(value)) {
+        perror("eventfd write");
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+render_thread::stop()
+{
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    stop_.store(true, std::memory_order_release);
+
+    uint64_t value = 1;
+    if (write(wake_fd_, &value, sizeof(value)) != sizeof(value)) {
+        perror("eventfd write");
+    }
+
+    thread_.join();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+render_thread::run()
+{
+    frame_snapshot frame;
+
+    while (true) {
+        if (queue_.pop(frame)) {
+            render(frame);
+            frame = frame_snapshot();
+
+            if (frame_digests_enabled_) {
+                frame_digests_.emplace_back(screen_->root_surface()->digest());
+            }
+
+            uint64_t value = 1;
+            if (write(done_fd_, &value, sizeof(value)) != sizeof(value)) {
+                perror("eventfd write");
+            }
+            continue;
+        }
+
+        // Queue drained
+        if (stop_.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        uint64_t value;
+        if (read(wake_fd_, &value, sizeof(value)) != sizeof(value)) {
+            perror("eventfd read");
+            break;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+render_thread::render(frame_snapshot& frame)
+{
+    PROFILE_ZONE("render_thread::render");
+
+    auto ts1 = get_ts();
+    frames_++;
+
+    {
+        // Replaying reads the snapshots, releasing the recording detaches
+        // them from their surfaces
+        std::lock_guard<std::mutex> lock(cairo_mutex_);
+
+        // Only the area the frame drew on
+        double x, y, width, height;
+        cairo_recording_surface_ink_extents(frame.recording->handle(), &x, &y, &width, &height);
+        if (width <= 0 || height <= 0) {
+            frame.recording = nullptr;
+            empty_frames_++;
+            return;
+        }
+
+        // Replaying OVER an empty recording equals drawing directly on the window
+        auto cr = screen_->root_surface()->cr();
+        cairo_save(cr);
+        cairo_rectangle(cr, floor(x), floor(y), ceil(x + width) - floor(x), ceil(y + height) - floor(y));
+        cairo_clip(cr);
+        cairo_set_source_surface(cr, frame.recording->handle(), 0, 0);
+        cairo_paint(cr);
+        cairo_restore(cr); // drops the reference to the recording
+        frame.recording = nullptr;
+    }
+
+    screen_->present();
+    if (latency_mode_) {
+        // Drawn into the server frame buffer, not just sent
+        screen_->sync();
+    }
+
+    auto now = get_ts();
+    render_times_.add(now - ts1);
+    queue_latency_.add(now - frame.submit_ts);
+
+    // Input to screen latency, measured once the drawing is sent to the server
+    if (frame.nr_input_events > 0) {
+        input_latency_count_ += frame.nr_input_events;
+        input_latency_sum_ += now * frame.nr_input_events - frame.input_ts_sum;
+        if (now - frame.earliest_input_ts > input_latency_max_) {
+            input_latency_max_ = now - frame.earliest_input_ts;
+        }
+    }
+
+    if (latency_mode_) {
+        add_latency_samples(frame, now);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+render_thread::add_latency_samples(const frame_snapshot& frame, int64_t present_ts)
+{
+    for(size_t i = 0; i < frame.nr_latency_samples; i++) {
+        auto& sample = frame.latency_samples[i];
+
+        if (sample.server_ts != 0) {
+            // Server time has ms resolution, clamp the rounding error
+            server_to_receive_.add(std::max<int64_t>(sample.receive_ts - sample.server_ts, 0));
+            server_to_present_.add(std::max<int64_t>(present_ts - sample.server_ts, 0));
+        }
+        receive_to_dispatch_.add(sample.dispatch_ts - sample.receive_ts);
+        scene_draw_.add(sample.drawn_ts - sample.dispatch_ts);
+        drawn_to_present_.add(present_ts - sample.drawn_ts);
+        receive_to_present_.add(present_ts - sample.receive_ts);
+        latency_samples_++;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+render_thread::print_latency_stats()
+{
+    printf("Latency mode: %lu key and button presses\n", static_cast<unsigned long>(latency_samples_));
+    printf("  X server to receive:  %s\n", server_to_receive_.summary().c_str());
+    printf("  Receive to dispatch:  %s\n", receive_to_dispatch_.summary().c_str());
+    printf("  Scene draw:           %s\n", scene_draw_.summary().c_str());
+    printf("  Drawn to present:     %s\n", drawn_to_present_.summary().c_str());
+    printf("  Receive to present:   %s\n", receive_to_present_.summary().c_str());
+    printf("  X server to present:  %s\n", server_to_present_.summary().c_str());
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+render_thread::print_stats()
+{
+    printf("Render thread: %lu frames (%lu empty), %lu waits on a full queue\n",
+           static_cast<unsigned long>(frames_),
+           static_cast<unsigned long>(empty_frames_),
+           static_cast<unsigned long>(queue_full_waits_));
+    printf("  Replay and present: %s\n", render_times_.summary().c_str());
+    printf("  Submit to present:  %s\n", queue_latency_.summary().c_str());
+
+    if (input_latency_count_ > 0) {
+        printf("Input to draw latency: %lu events, avg %ld us, max %ld us\n",
+               static_cast<unsigned long>(input_latency_count_),
+               static_cast<long>(input_latency_sum_ / static_cast<int64_t>(input_latency_count_)),
+               static_cast<long>(input_latency_max_));
+    }
+
+    if (latency_mode_) {
+        print_latency_stats();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
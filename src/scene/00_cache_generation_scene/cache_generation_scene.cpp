@@ -27,20 +27,16 @@ cache_generation_scene::cache_generation_scene(std::shared_ptr<rendering_context
   : scene(ctx, sur_cache)
 {
   auto obj = std::shared_ptr<object>(new text_object(ctx_, sur_cache_, 520, 345, 1270, 25, "Loading...", 60));
-  objects_.emplace_back(obj);
+  add_object(obj);
 }
 
 void cache_generation_scene::draw()
 {
-    for(auto&& object : objects_) {
-        object->draw();
-    }
+    draw_dirty_objects();
 }
 
-void cache_generation_scene::draw(ui_event ev)
+void cache_generation_scene::draw(const ui_event& ev)
 {
-    for(auto&& object : objects_) {
-        object->draw();
-    }
+    draw_dirty_objects();
 }
 
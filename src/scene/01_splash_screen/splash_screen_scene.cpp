@@ -23,26 +23,35 @@
 #include <object/splash_screen_object.hpp>
 #include <common.hpp>
 
+constexpr int64_t splash_duration = 6000; // unit: ms
+
 splash_screen_scene::splash_screen_scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache)
   : scene(ctx, sur_cache)
 {
   auto splash_screen = std::shared_ptr<object>(new splash_screen_object(ctx, sur_cache, 0, 45, 1280, 720));
-  objects_.emplace_back(splash_screen);
+  add_object(splash_screen);
 }
 
 void splash_screen_scene::begin()
 {
-  started_ts_ = get_ts();
+  started_ts_ = get_game_ts();
 }
 
-void splash_screen_scene::draw()
+int64_t splash_screen_scene::next_deadline()
 {
-    for(auto&& object : objects_) {
-        object->draw();
+    if (started_ts_ == 0) {
+        return 0;
     }
 
-    auto elapsed_time = (get_ts() - started_ts_) / 1000; // unit: ms
-    if (started_ts_ != 0 && elapsed_time > 6000) {
+    return started_ts_ + (splash_duration + 1) * 1000;
+}
+
+void splash_screen_scene::draw()
+{
+    draw_dirty_objects();
+
+    auto elapsed_time = (get_game_ts() - started_ts_) / 1000; // unit: ms
+    if (started_ts_ != 0 && elapsed_time > splash_duration) {
       ended_ = true;
     }
 
@@ -51,7 +60,7 @@ void splash_screen_scene::draw()
     }
 }
 
-void splash_screen_scene::draw(ui_event ev)
+void splash_screen_scene::draw(const ui_event& ev)
 {
 
 }
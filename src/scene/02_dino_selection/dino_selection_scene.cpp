@@ -17,10 +17,13 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>
  */
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 
 #include <common.hpp>
 #include <object/background_object.hpp>
+#include <profiler.hpp>
 #include <scene/02_dino_selection/dino_selection_scene.hpp>
 
 constexpr double top_left_x = 50;
@@ -38,11 +41,17 @@ constexpr double dino_object_height = 250;
 
 constexpr size_t nr_pages = 9;
 
+// Pages cover the screen below the top bar
+constexpr double page_top = 45;
+
+constexpr int64_t page_transition_time = 250000;                 // unit: us
+constexpr int64_t page_transition_frame_period = 1000000 / 120;  // unit: us
+
 dino_selection_scene::dino_selection_scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache)
   : scene(ctx, sur_cache)
 {
   auto obj = std::shared_ptr<object>(new background_object(ctx_, sur_cache_, 0, 45, ctx->screen_width(), ctx->screen_height()));
-  objects_.emplace_back(obj);
+  add_static_object(obj);
 
   // Preload all pages (during splash screen)
   page_idx_ = 0;
@@ -53,6 +62,13 @@ dino_selection_scene::dino_selection_scene(std::shared_ptr<rendering_context> ct
   left_nav_object_ = std::shared_ptr<navigate_object>(new navigate_object(ctx_, sur_cache_, 550, 340, 80, 40, navigation_state::previous_first));
   right_nav_object_ = std::shared_ptr<navigate_object>(new navigate_object(ctx_, sur_cache_, 640, 340, 80, 40, navigation_state::next));
   continue_nav_object_ = std::shared_ptr<navigate_object>(new navigate_object(ctx_, sur_cache_, 595, 415, 80, 40, navigation_state::continue_blocked));
+
+  // Above the page
+  add_object(left_nav_object_);
+  add_object(right_nav_object_);
+  add_object(continue_nav_object_);
+
+  update_pointer_objects();
 }
 
 dino_selection_page dino_selection_scene::load_page(size_t page_idx)
@@ -426,29 +442,21 @@ dino_selection_page dino_selection_scene::load_page(size_t page_idx)
 
 void dino_selection_scene::draw()
 {
-    for(auto&& object : objects_) {
-        object->draw();
-    }
-
-    if (pages_[page_idx_].top_left_object != nullptr) {
-      pages_[page_idx_].top_left_object->draw();
+    if (draw_static_layer()) {
+        page_drawn_ = false;
     }
 
-    if (pages_[page_idx_].top_right_object != nullptr) {
-      pages_[page_idx_].top_right_object->draw();
-    }
+    draw_page();
+    draw_page_objects();
+    draw_dirty_objects();
 
-    if (pages_[page_idx_].bottom_left_object != nullptr) {
-      pages_[page_idx_].bottom_left_object->draw();
+    // Pages for the next slide, one per frame and not while input is
+    // handled or a slide runs, see next_deadline()
+    if (input_frame_) {
+        input_frame_ = false;
+    } else if (transition_ts_ == 0) {
+        prefetch_page();
     }
-
-    if (pages_[page_idx_].bottom_right_object != nullptr) {
-      pages_[page_idx_].bottom_right_object->draw();
-    }
-
-    left_nav_object_->draw();
-    right_nav_object_->draw();
-    continue_nav_object_->draw();
 }
 
 int dino_selection_scene::nr_selected_dinos()
@@ -483,17 +491,21 @@ int dino_selection_scene::nr_selected_dinos()
   return nr_selected_dinos;
 }
 
-void dino_selection_scene::draw(ui_event ev)
+void dino_selection_scene::draw(const ui_event& ev)
 {
-  // Feed event into navigation objects
-    left_nav_object_->draw(ev);
-    right_nav_object_->draw(ev);
-    continue_nav_object_->draw(ev);
+  input_frame_ = true;
+
+  // Feed event into the objects under the pointer
+    for(auto&& obj : pointer_targets(ev)) {
+      obj->update(ev);
+    }
 
   // Update navigation state
     if (left_nav_object_->is_selected()) {
       if (page_idx_ > 0) {
         page_idx_--;
+        start_transition(page_idx_ + 1, -1);
+        update_pointer_objects();
       }
       left_nav_object_->unselect();
 
@@ -511,12 +523,13 @@ void dino_selection_scene::draw(ui_event ev)
 
       left_nav_object_->invalidate();
       right_nav_object_->invalidate();
-      invalidate_pages();
     }
 
     if (right_nav_object_->is_selected()) {
       if (page_idx_ < nr_pages - 1) {
         page_idx_++;
+        start_transition(page_idx_ - 1, 1);
+        update_pointer_objects();
       } 
 
       if (page_idx_ == 0) {
@@ -534,28 +547,14 @@ void dino_selection_scene::draw(ui_event ev)
       right_nav_object_->unselect();
       left_nav_object_->invalidate();
       right_nav_object_->invalidate();
-      invalidate_pages();
     }
 
-  for(auto&& object : objects_) {
-      object->draw(ev);
+  if (draw_static_layer()) {
+    page_drawn_ = false;
   }
 
-  if (pages_[page_idx_].top_left_object != nullptr) {
-    pages_[page_idx_].top_left_object->draw(ev);
-  }
-
-  if (pages_[page_idx_].top_right_object != nullptr) {
-    pages_[page_idx_].top_right_object->draw(ev);
-  }
-
-  if (pages_[page_idx_].bottom_left_object != nullptr) {
-    pages_[page_idx_].bottom_left_object->draw(ev);
-  }
-
-  if (pages_[page_idx_].bottom_right_object != nullptr) {
-    pages_[page_idx_].bottom_right_object->draw(ev);
-  }
+  draw_page();
+  draw_page_objects();
 
   // Update selection state
   auto selected_dinos = nr_selected_dinos();
@@ -579,31 +578,196 @@ void dino_selection_scene::draw(ui_event ev)
   }
 
   // Draw ontop
-  left_nav_object_->draw();
-  right_nav_object_->draw();
-  continue_nav_object_->draw();
+  draw_dirty_objects();
 }
 
-void dino_selection_scene::invalidate_pages()
+void dino_selection_scene::invalidate()
 {
-  for(auto p : pages_) {
-    if (p.top_left_object != nullptr) {
-      p.top_left_object->invalidate();
+    scene::invalidate();
+    page_drawn_ = false;
+}
+
+void dino_selection_scene::invalidate(const rect& r)
+{
+    scene::invalidate(r);
+    if (overlaps(r, { 0, page_top, ref_width, ref_height - page_top })) {
+        page_drawn_ = false;
     }
+}
 
-    if (p.top_right_object != nullptr) {
-      p.top_right_object->invalidate();
+int64_t dino_selection_scene::next_deadline()
+{
+    if (transition_ts_ != 0) {
+        return transition_frame_ts_ + page_transition_frame_period;
     }
 
-    if (p.bottom_left_object != nullptr) {
-      p.bottom_left_object->invalidate();
+    if (pages_pending()) {
+        return get_game_ts() + page_transition_frame_period;
     }
 
-    if (p.bottom_right_object != nullptr) {
-      p.bottom_right_object->invalidate();
+    return 0;
+}
+
+void dino_selection_scene::update_pointer_objects()
+{
+    std::vector<object*> objs = { left_nav_object_.get(), right_nav_object_.get(), continue_nav_object_.get() };
+    for(auto&& obj : pages_[page_idx_].objects()) {
+        if (obj != nullptr) {
+            objs.emplace_back(obj.get());
+        }
     }
-  }
 
+    set_pointer_objects(objs);
+}
+
+uint32_t dino_selection_scene::page_selection(size_t page_idx)
+{
+    uint32_t selection = 0;
+    auto objs = pages_[page_idx].objects();
+    for(size_t i = 0; i < objs.size(); i++) {
+        if (objs[i] != nullptr && objs[i]->is_selected()) {
+            selection |= 1u << i;
+        }
+    }
+
+    return selection;
+}
+
+bool dino_selection_scene::page_ready(size_t page_idx)
+{
+    auto& page = pages_[page_idx];
+    return page.rendered != nullptr && page.rendered_selection == page_selection(page_idx);
+}
+
+std::shared_ptr<surface> dino_selection_scene::page_surface(size_t page_idx)
+{
+    auto& page = pages_[page_idx];
+    if (page_ready(page_idx)) {
+        return page.rendered;
+    }
+
+    PROFILE_ZONE("dino_selection_scene::render_page");
+
+    // Always a new surface, recorded frames not yet on screen may still
+    // refer to the previous one. Below the top bar, at the whole pixel
+    // begin_layer() and draw_layer() round page_top to.
+    auto top = std::round(ctx_->scale(page_top));
+    auto rendered = std::shared_ptr<surface>(new surface(ctx_->screen_width(), ctx_->screen_height() - top, true));
+    rendered->load_background(0, 0, 0);
+
+    // Hover is drawn over the page by draw_page_objects(), so the page
+    // stays valid until the selection changes
+    ctx_->begin_layer(rendered, 0, page_top);
+    for(auto&& obj : page.objects()) {
+        if (obj != nullptr) {
+            obj->draw_resting();
+        }
+    }
+    ctx_->end_layer();
+
+    rendered->set_immutable();
+    page.rendered = rendered;
+    page.rendered_selection = page_selection(page_idx);
+
+    for(size_t i = 0; i < nr_pages; i++) {
+        if (i + 1 < page_idx_ || i > page_idx_ + 1) {
+            pages_[i].rendered = nullptr;
+        }
+    }
+
+    return rendered;
+}
+
+bool dino_selection_scene::prefetch_page()
+{
+    size_t first = page_idx_ > 0 ? page_idx_ - 1 : 0;
+    size_t last = std::min(page_idx_ + 1, nr_pages - 1);
+    for(size_t i = first; i <= last; i++) {
+        if (!page_ready(i)) {
+            page_surface(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool dino_selection_scene::pages_pending()
+{
+    size_t first = page_idx_ > 0 ? page_idx_ - 1 : 0;
+    size_t last = std::min(page_idx_ + 1, nr_pages - 1);
+    for(size_t i = first; i <= last; i++) {
+        if (!page_ready(i)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Both pages are normally prefetched. Rendered here only when the pointer
+// is faster than prefetch_page().
+void dino_selection_scene::start_transition(size_t from_idx, int direction)
+{
+    transition_from_ = page_surface(from_idx);
+    transition_to_ = page_surface(page_idx_);
+    transition_direction_ = direction;
+    transition_ts_ = get_game_ts();
+    transition_frame_ts_ = transition_ts_;
+}
+
+void dino_selection_scene::draw_page()
+{
+    if (transition_ts_ != 0) {
+        auto t = static_cast<double>(get_game_ts() - transition_ts_) / static_cast<double>(page_transition_time);
+        if (t < 1.0) {
+            // Ease out, in whole pixels so cairo copies instead of filtering
+            auto page_width = ctx_->screen_width();
+            auto shift = std::round(page_width * (1.0 - (1.0 - t) * (1.0 - t)));
+
+            ctx_->draw_layer(transition_from_, ctx_->iscale(-transition_direction_ * shift), page_top);
+            ctx_->draw_layer(transition_to_, ctx_->iscale(transition_direction_ * (page_width - shift)), page_top);
+            transition_frame_ts_ = get_game_ts();
+
+            damage({ 0, page_top, ref_width, ref_height - page_top });
+            return;
+        }
+
+        transition_from_ = nullptr;
+        transition_to_ = nullptr;
+        transition_ts_ = 0;
+        page_drawn_ = false;
+    }
+
+    if (page_drawn_) {
+        return;
+    }
+
+    ctx_->draw_layer(page_surface(page_idx_), 0, page_top);
+    page_drawn_ = true;
+
+    damage({ 0, page_top, ref_width, ref_height - page_top });
+
+    // The cached page shows every object resting
+    for(auto&& obj : pages_[page_idx_].objects()) {
+        if (obj != nullptr && !obj->is_resting()) {
+            obj->invalidate();
+        }
+    }
+}
+
+void dino_selection_scene::draw_page_objects()
+{
+    if (transition_ts_ != 0) {
+        return;
+    }
+
+    for(auto&& obj : pages_[page_idx_].objects()) {
+        if (obj != nullptr && obj->invalidated()) {
+            obj->draw();
+            damage(obj->bounds());
+        }
+    }
 }
 
 void dino_selection_scene::determine_selected_svg_paths()
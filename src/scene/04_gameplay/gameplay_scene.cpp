@@ -18,46 +18,79 @@
  */
 
 #include <ctype.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
-#include <random>
 #include <sstream>
 #include <unistd.h>
 
 #include <common.hpp>
 #include <object/background_object.hpp>
 #include <object/dashed_line_object.hpp>
+#include <profiler.hpp>
 #include <scene/04_gameplay/gameplay_scene.hpp>
 
-gameplay_scene::gameplay_scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache)
+// Number of random layouts per collage configuration. Repeated
+// configurations are served from the collage cache.
+constexpr int collage_variants = 8;
+
+constexpr size_t collage_cache_max_bytes = 64 * 1024 * 1024;
+
+// How long a correct answer stays on screen
+constexpr int64_t answer_display_time = 5000; // unit: ms
+
+gameplay_scene::gameplay_scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache, std::shared_ptr<random_generator> rng)
     : scene(ctx, sur_cache)
+    , rng_(rng)
 {
+  // Background and separators never change, see draw_static_layer()
   auto obj = std::shared_ptr<object>(new background_object(ctx_, sur_cache_, 0, 45, 1280, 720));
-  objects_.emplace_back(obj);
+  add_static_object(obj);
 
   equation_text_obj_ = std::shared_ptr<text_object>(new text_object(ctx_, sur_cache_, 25, 370, 1300, 75, "", 75));
   equation_text_obj_->set_bg(0.1,0.1,0.1);
 
-  left_side_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, 10, 40, 600, 300, selected_svg_paths_, 0));
-  right_side_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, 670, 40, 600, 300, selected_svg_paths_, 0));
+  collage_cache_ = std::make_shared<collage_cache>(collage_cache_max_bytes);
+
+  left_side_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, collage_cache_, 10, 40, 600, 300, selected_svg_paths_, 0));
+  right_side_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, collage_cache_, 670, 40, 600, 300, selected_svg_paths_, 0));
+
+  left_answer_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, collage_cache_, 10, 455, 420, 230, selected_svg_paths_, 0));
+  middle_answer_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, collage_cache_, 429, 455, 420, 230, selected_svg_paths_, 0));
+  right_answer_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, collage_cache_, 848, 455, 420, 230, selected_svg_paths_, 0));
 
-  left_answer_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, 10, 455, 420, 230, selected_svg_paths_, 0));
-  middle_answer_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, 429, 455, 420, 230, selected_svg_paths_, 0));
-  right_answer_collage_obj_ = std::shared_ptr<dino_collage_object>(new dino_collage_object(ctx_, sur_cache_, 848, 455, 420, 230, selected_svg_paths_, 0));
+  collage_objs_ = { left_side_collage_obj_, right_side_collage_obj_,
+                    left_answer_collage_obj_, middle_answer_collage_obj_, right_answer_collage_obj_ };
 
   status_text_obj_ = std::shared_ptr<text_object>(new text_object(ctx_, sur_cache_, 10, 690, 1270, 25, "", 25));
 
+  // Drawing order, see draw_dirty_objects()
+  add_object(equation_text_obj_);
+  add_object(status_text_obj_);
+  for(auto&& obj : collage_objs_) {
+      add_object(obj);
+  }
+
+  worker_ = std::make_shared<background_worker>();
+
   auto dashes = std::vector<double>();
   dashes.emplace_back(7.5);
   obj = std::shared_ptr<object>(new dashed_line_object(ctx_, sur_cache_, {0,345}, {1300, 345}, 1.0, 0.834, 0.168, 2, dashes, 0 ));
-  dashed_line_objs_.emplace_back(obj);
+  add_static_object(obj);
   obj = std::shared_ptr<object>(new dashed_line_object(ctx_, sur_cache_, {0,447}, {1300, 447}, 1.0, 0.834, 0.168, 2, dashes, 0 ));
-  dashed_line_objs_.emplace_back(obj);
+  add_static_object(obj);
 }
 
+
 void gameplay_scene::reset_gameplay_state()
 {
+    // Generated with the old state
+    wait_upcoming_tasks();
+    upcoming_.clear();
+
     level_ = 1;
-    iteration_ = 1;
+    iteration_ = 0;
     total_steps_ = 3;
     points_ = 0;
     left_operand_min_ = 2;
@@ -69,34 +102,52 @@ void gameplay_scene::simulate_gameplay(std::vector<std::string>& selected_svg_pa
 {
     set_selected_svg_paths(selected_svg_paths);
 
-    begin();
+    for(auto&& obj : collage_objs_) {
+        obj->set_selected_svg_paths(selected_svg_paths_);
+    }
+
+    // One task for the sprites it puts in the cache. Not queued, begin()
+    // builds the tasks of the real game.
+    auto task = generate_task();
+    build_task(task);
+    task->built.wait();
+
     reset_gameplay_state();
 }
 
 void gameplay_scene::begin()
 {
+    // The worker reads the selection while building
+    wait_upcoming_tasks();
 
-    left_side_collage_obj_->set_selected_svg_paths(selected_svg_paths_);
-    right_side_collage_obj_->set_selected_svg_paths(selected_svg_paths_);
-    left_answer_collage_obj_->set_selected_svg_paths(selected_svg_paths_);
-    middle_answer_collage_obj_->set_selected_svg_paths(selected_svg_paths_);
-    right_answer_collage_obj_->set_selected_svg_paths(selected_svg_paths_);
+    for(auto&& obj : collage_objs_) {
+        obj->set_selected_svg_paths(selected_svg_paths_);
+    }
+
+    // Built for the previous selection
+    for(auto&& task : upcoming_) {
+        build_task(task);
+    }
 
     next_task();
 }
 
 int gameplay_scene::random_value(int range_begin, int range_end)
 {
-    std::random_device rd;
-    std::uniform_int_distribution<int> dist(range_begin, range_end);
-    return dist(rd);
+    return rng_->uniform(range_begin, range_end);
 }
 
 void gameplay_scene::update_status()
 {
+    auto values = std::make_tuple(task_->level, task_->iteration, total_steps_, points_, task_elapsed_time_);
+    if (values == status_values_) {
+        return;
+    }
+    status_values_ = values;
+
     std::stringstream ss;
-    ss << "Level  " << std::setfill('0') << std::setw(3) << level_ << "  "
-       << "Iteration  " << std::setfill('0') << std::setw(3) << iteration_ 
+    ss << "Level  " << std::setfill('0') << std::setw(3) << task_->level << "  "
+       << "Iteration  " << std::setfill('0') << std::setw(3) << task_->iteration 
        << "/" << std::setfill('0') << std::setw(3) << total_steps_ << "  "
        << "Points  " << std::setfill('0') << std::setw(9) << points_;
 
@@ -104,13 +155,12 @@ void gameplay_scene::update_status()
         ss << "  (time to answer " << task_elapsed_time_ << " ms)";
     }
     status_text_obj_->set_text(ss.str());
-    status_text_obj_->draw();
 }
 
-void gameplay_scene::next_task()
+std::shared_ptr<gameplay_task> gameplay_scene::generate_task()
 {
-    // Generate new task
-    operator_ = '+';
+    auto task = std::make_shared<gameplay_task>();
+    task->op = '+';
 
     prev_answer_ = answer_;
     while(answer_ == prev_answer_) {
@@ -124,11 +174,15 @@ void gameplay_scene::next_task()
             right_operand_ = random_value(1, right_operand_delta_);
         }
 
-        if (operator_ == '+') {
+        if (task->op == '+') {
             answer_ = left_operand_ + right_operand_;
         }
     }
 
+    task->left_operand = left_operand_;
+    task->right_operand = right_operand_;
+    task->answer = answer_;
+
     iteration_++;
     if (iteration_ > total_steps_) {
         iteration_ = 1;
@@ -142,39 +196,50 @@ void gameplay_scene::next_task()
         }
     }
 
-    // Clear old state
-    user_input_.clear();
-    correct_ts_ = 0;
+    task->level = level_;
+    task->iteration = iteration_;
+
+    //*** Collage layout. Adjust grid sizes when applicable ***
+    task->collage_seed = static_cast<uint32_t>(random_value(0, collage_variants - 1));
+
+    auto& left_side = task->collages[0];
+    auto& right_side = task->collages[1];
+    auto& left_answer = task->collages[2];
+    auto& middle_answer = task->collages[3];
+    auto& right_answer = task->collages[4];
 
-    //*** Generate graphics. Adjust grid sizes when applicable ***
     grid grid_setup;
     grid_setup.nr_cols = 0;
     grid_setup.nr_rows = 0;
-   
+
+    left_side.nr_dinos = left_operand_;
+    right_side.nr_dinos = right_operand_;
     if (left_operand_ > right_operand_) {
-        grid_setup = left_side_collage_obj_->set_nr_dinos(left_operand_, grid_setup);
-        right_side_collage_obj_->set_nr_dinos(right_operand_, grid_setup);
+        left_side.grid_setup = grid_setup;
+        grid_setup = dino_collage_object::fit_grid(left_operand_, grid_setup);
+        right_side.grid_setup = grid_setup;
     } else {
-        grid_setup = right_side_collage_obj_->set_nr_dinos(right_operand_, grid_setup);
-        left_side_collage_obj_->set_nr_dinos(left_operand_, grid_setup);
+        right_side.grid_setup = grid_setup;
+        grid_setup = dino_collage_object::fit_grid(right_operand_, grid_setup);
+        left_side.grid_setup = grid_setup;
     }
 
     // Reset
     grid_setup.nr_cols = 0;
     grid_setup.nr_rows = 0;
 
+    int nr_left = 0;
+    int nr_middle = 0;
+    int nr_right = 0;
+
     if (answer_ <= 4) { // up to 4
-        left_answer_collage_obj_->set_nr_dinos(answer_, grid_setup);
-        middle_answer_collage_obj_->set_nr_dinos(0, grid_setup);
-        right_answer_collage_obj_->set_nr_dinos(0, grid_setup);
+        nr_left = answer_;
     } else if (answer_ <= 8) { // up to 8
-        left_answer_collage_obj_->set_nr_dinos(4, grid_setup);
-        auto remaining = answer_ - 4;
-        middle_answer_collage_obj_->set_nr_dinos(remaining, grid_setup);
-        right_answer_collage_obj_->set_nr_dinos(0, grid_setup);
+        nr_left = 4;
+        nr_middle = answer_ - 4;
     } else { // above 8
         auto third = static_cast<int>(static_cast<double>(answer_) / 3.0);
-        grid_setup = left_answer_collage_obj_->set_nr_dinos(third, grid_setup);
+        grid_setup = dino_collage_object::fit_grid(third, grid_setup);
         third += (grid_setup.nr_cols * grid_setup.nr_rows) - third;
         auto remaining = answer_ - (2 * third);
         auto diff = remaining % third;
@@ -182,51 +247,131 @@ void gameplay_scene::next_task()
             grid_setup.nr_cols++;
             third = grid_setup.nr_rows * grid_setup.nr_cols;
 
-            grid_setup = left_answer_collage_obj_->set_nr_dinos(third, grid_setup);
+            nr_left = third;
             remaining = answer_ - third;
 
             if (remaining > third) {
-                middle_answer_collage_obj_->set_nr_dinos(third, grid_setup);
+                nr_middle = third;
                 remaining -= third;
             } else {
-                middle_answer_collage_obj_->set_nr_dinos(remaining, grid_setup);
+                nr_middle = remaining;
                 remaining = 0;
             }
 
-            right_answer_collage_obj_->set_nr_dinos(remaining, grid_setup);
+            nr_right = remaining;
         } else { // even number
-            left_answer_collage_obj_->set_nr_dinos(third, grid_setup);
-            middle_answer_collage_obj_->set_nr_dinos(third, grid_setup);
-            right_answer_collage_obj_->set_nr_dinos(third, grid_setup);
+            nr_left = third;
+            nr_middle = third;
+            nr_right = third;
         }
     }
 
+    left_answer = { nr_left, grid_setup, 0, nullptr };
+    middle_answer = { nr_middle, grid_setup, 0, nullptr };
+    right_answer = { nr_right, grid_setup, 0, nullptr };
+
+    // One seed per collage, or all five would share the same layout.
+    // Still one of collage_variants per collage, so layouts are reused.
+    for(size_t i = 0; i < task_collages; i++) {
+        task->collages[i].seed = static_cast<uint32_t>(random_generator::splitmix64(task->collage_seed + i));
+    }
+
+    return task;
+}
+
+void gameplay_scene::build_task(std::shared_ptr<gameplay_task> task)
+{
+    auto objs = collage_objs_;
+    task->built = worker_->post([task, objs] {
+        PROFILE_ZONE("gameplay_scene::build_task");
+
+        for(size_t i = 0; i < task_collages; i++) {
+            auto& c = task->collages[i];
+            c.collage = objs[i]->build_collage(c.nr_dinos, c.grid_setup, c.seed);
+        }
+    });
+}
+
+void gameplay_scene::fill_upcoming_tasks()
+{
+    while (upcoming_.size() < tasks_ahead) {
+        auto task = generate_task();
+        build_task(task);
+        upcoming_.emplace_back(task);
+    }
+}
+
+void gameplay_scene::wait_upcoming_tasks()
+{
+    for(auto&& task : upcoming_) {
+        task->built.wait();
+    }
+}
+
+void gameplay_scene::next_task()
+{
+    PROFILE_ZONE("gameplay_scene::next_task");
+
+    fill_upcoming_tasks();
+
+    auto task = upcoming_.front();
+    upcoming_.pop_front();
+
+    // Normally built long ago, while the previous answer was on screen
+    if (task->built.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        auto wait_ts = get_ts();
+        task->built.wait();
+        tasks_waited_++;
+        max_task_wait_ = std::max(max_task_wait_, get_ts() - wait_ts);
+    }
+    tasks_shown_++;
+    task_ = task;
+
+    for(size_t i = 0; i < task_collages; i++) {
+        collage_objs_[i]->set_collage(task->collages[i].nr_dinos, task->collages[i].collage);
+    }
+
     left_answer_collage_obj_->set_visibility(false);
     middle_answer_collage_obj_->set_visibility(false);
     right_answer_collage_obj_->set_visibility(false);
 
+    // Clear old state
+    user_input_.clear();
+    correct_ts_ = 0;
+
     // new timestamp
-    task_ts_ = get_ts();
+    task_ts_ = get_game_ts();
     task_elapsed_time_ = 0;
+
+    // Start on the ones after
+    fill_upcoming_tasks();
+}
+
+void gameplay_scene::print_statistics()
+{
+    printf("Gameplay tasks: %lu shown, %lu waited for their collages (max %.1f ms)\n",
+           static_cast<unsigned long>(tasks_shown_),
+           static_cast<unsigned long>(tasks_waited_),
+           static_cast<double>(max_task_wait_) / 1000.0);
+    collage_cache_->print_stats();
 }
 
 bool gameplay_scene::is_correct_answer()
 {
-    return (answer_ == atoi(user_input_.c_str()));
+    return (task_->answer == atoi(user_input_.c_str()));
 }
 
 void gameplay_scene::update_equation()
 {
     std::stringstream ss;
-    ss << left_operand_ << " " << operator_ << " " << right_operand_ << " = " << user_input_;
+    ss << task_->left_operand << " " << task_->op << " " << task_->right_operand << " = " << user_input_;
     equation_text_obj_->set_text(ss.str());
-    equation_text_obj_->draw();
 
     if (correct_ts_ == 0) {
         if (is_correct_answer()) {
             // show answer and delay a bit, then clear
-            correct_ts_ = get_ts();
-            task_elapsed_time_ = (get_ts() - task_ts_) / 1000;
+            correct_ts_ = get_game_ts();
+            task_elapsed_time_ = (get_game_ts() - task_ts_) / 1000;
 
             int multiplier = 1;
             if (task_elapsed_time_ < 62) {
@@ -244,7 +389,7 @@ void gameplay_scene::update_equation()
             } else if (task_elapsed_time_ < 4000) {
                 multiplier = 2;
             }
-            int score = level_ * multiplier;
+            int score = task_->level * multiplier;
 
             user_input_ += "  Correct! (" + std::to_string(score) + " point";
             if (score > 1) {
@@ -257,9 +402,6 @@ void gameplay_scene::update_equation()
             left_answer_collage_obj_->set_visibility(true);
             middle_answer_collage_obj_->set_visibility(true);
             right_answer_collage_obj_->set_visibility(true);
-            for(auto&& obj : dashed_line_objs_) {
-                obj->invalidate();
-            }
         }
     }
 }
@@ -271,20 +413,27 @@ bool gameplay_scene::correct_ts_has_expired()
         return false; 
     }
 
-    auto elapsed_time = (get_ts() - correct_ts_) / 1000; // unit: ms
-    if (elapsed_time > 5000) {
+    auto elapsed_time = (get_game_ts() - correct_ts_) / 1000; // unit: ms
+    if (elapsed_time > answer_display_time) {
       return true;
     }
     
     return false;
 }
 
-void gameplay_scene::draw()
+int64_t gameplay_scene::next_deadline()
 {
-    for(auto&& object : objects_) {
-        object->draw();
+    if (correct_ts_ == 0) {
+        return 0;
     }
 
+    return correct_ts_ + (answer_display_time + 1) * 1000;
+}
+
+void gameplay_scene::draw()
+{
+    draw_static_layer();
+
     if (correct_ts_has_expired()) {
         next_task();
     }
@@ -292,19 +441,10 @@ void gameplay_scene::draw()
     update_equation();
     update_status();
 
-    left_side_collage_obj_->draw();
-    right_side_collage_obj_->draw();
-
-    left_answer_collage_obj_->draw();
-    middle_answer_collage_obj_->draw();
-    right_answer_collage_obj_->draw();
-
-    for(auto&& obj : dashed_line_objs_) {
-        obj->draw();
-    }
+    draw_dirty_objects();
 }
 
-void gameplay_scene::draw(ui_event ev)
+void gameplay_scene::draw(const ui_event& ev)
 {
     auto c = ev.get_c();
     if (c >= '0' && c <= '9') {
@@ -317,9 +457,7 @@ void gameplay_scene::draw(ui_event ev)
         }
     }
 
-    for(auto&& object : objects_) {
-        object->draw();
-    }
+    draw_static_layer();
 
     if ((correct_ts_has_expired() || 
          ev.get_c() == 13 ||
@@ -331,14 +469,6 @@ void gameplay_scene::draw(ui_event ev)
     update_equation();
     update_status();
 
-    left_side_collage_obj_->draw();
-    right_side_collage_obj_->draw();
-    left_answer_collage_obj_->draw();
-    middle_answer_collage_obj_->draw();
-    right_answer_collage_obj_->draw();
-
-    for(auto&& obj : dashed_line_objs_) {
-        obj->draw();
-    }
+    draw_dirty_objects();
 }
 
@@ -17,8 +17,10 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>
  */
 
+#include <algorithm>
 #include <iostream>
 
+#include <profiler.hpp>
 #include <scene/scene.hpp>
 
 scene::scene(std::shared_ptr<rendering_context> ctx, std::shared_ptr<surface_cache> sur_cache)
@@ -37,12 +39,115 @@ void scene::draw()
 
 void scene::add_object(std::shared_ptr<object> object)
 {
+    dirty_.add(object.get());
     objects_.emplace_back(object);
 }
 
-void scene::invalidate()
+void scene::add_static_object(std::shared_ptr<object> object)
+{
+    static_objects_.emplace_back(object);
+    rebuild_static_layer();
+}
+
+void scene::rebuild_static_layer()
+{
+    static_layer_ = nullptr;
+    static_damage_ = { 0, 0, ref_width, ref_height };
+}
+
+void scene::invalidate_objects()
 {
     for(auto&& object : objects_) {
         object->invalidate();
     }
-}
\ No newline at end of file
+}
+
+void scene::invalidate()
+{
+    invalidate_objects();
+    static_damage_ = { 0, 0, ref_width, ref_height };
+}
+
+void scene::invalidate(const rect& r)
+{
+    damage(r);
+    static_damage_ = united(static_damage_, r);
+}
+
+bool scene::draw_static_layer()
+{
+    if (static_objects_.empty()) {
+        return false;
+    }
+
+    if (static_layer_ != nullptr &&
+        (static_layer_->width() != ctx_->screen_width() || static_layer_->height() != ctx_->screen_height())) {
+        rebuild_static_layer();
+    }
+
+    if (static_layer_ == nullptr) {
+        PROFILE_ZONE("scene::render_static_layer");
+
+        // Always a new surface, recorded frames not yet on screen may still
+        // refer to the previous one. Transparent where nothing is drawn.
+        auto layer = std::shared_ptr<surface>(new surface(ctx_->screen_width(), ctx_->screen_height()));
+        layer->load_transparent();
+
+        ctx_->begin_layer(layer);
+        for(auto&& object : static_objects_) {
+            object->invalidate();
+            object->draw();
+        }
+        ctx_->end_layer();
+
+        layer->set_immutable();
+        static_layer_ = layer;
+    }
+
+    if (static_damage_.width <= 0 || static_damage_.height <= 0) {
+        return false;
+    }
+
+    auto area = static_damage_;
+    static_damage_ = { 0, 0, 0, 0 };
+
+    if (area.x <= 0 && area.y <= 0 && area.x + area.width >= ref_width && area.y + area.height >= ref_height) {
+        ctx_->draw_layer(static_layer_, 0, 0);
+        invalidate_objects();
+    } else {
+        ctx_->draw_surface_area(static_layer_, 0, 0, area);
+        damage(area);
+    }
+
+    return true;
+}
+
+void scene::set_pointer_objects(const std::vector<object*>& objects)
+{
+    pointer_grid_.clear();
+    for(auto&& object : objects) {
+        pointer_grid_.insert(object);
+    }
+
+    under_pointer_ = objects;
+}
+
+const std::vector<object*>& scene::pointer_targets(const ui_event& ev)
+{
+    auto x = static_cast<double>(ev.get_x());
+    auto y = static_cast<double>(ev.get_y());
+
+    pointer_targets_.swap(under_pointer_);
+    under_pointer_.clear();
+
+    for(auto&& object : pointer_grid_.cell(x, y)) {
+        if (object->intersect(x, y)) {
+            under_pointer_.emplace_back(object);
+            if (std::find(pointer_targets_.begin(), pointer_targets_.end(), object) == pointer_targets_.end()) {
+                pointer_targets_.emplace_back(object);
+            }
+        }
+    }
+
+    return pointer_targets_;
+}
@@ -17,6 +17,7 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>
  */
 
+#include <errno.h>
 #include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
@@ -35,80 +36,242 @@ timer::timer()
 
 //---------------------------------------------------------------------------------------------------------------------------
 
-uint64_t
-timer::register_one_shot_timer(std::chrono::milliseconds duration)
+timer::~timer()
 {
-    int timer_fd;
-    struct itimerspec ts;
-    uint64_t res;
+    epoll_teardown();
+}
 
-    timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+//---------------------------------------------------------------------------------------------------------------------------
+
+int
+timer::timerfd_setup(std::chrono::nanoseconds duration, bool periodic)
+{
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
     if (timer_fd < 0) {
+        perror("timerfd_create");
+        return -1;
     }
 
-    ts.it_interval.tv_sec = 0;
-    ts.it_interval.tv_nsec = 0;
-    ts.it_value.tv_sec = duration.count() / 1000;
-    ts.it_value.tv_nsec = (duration.count() % 1000) * 1000000;
+    // Zero would disarm the timer
+    if (duration.count() <= 0) {
+        duration = std::chrono::nanoseconds(1);
+    }
+
+    timerfd_arm(timer_fd, duration, periodic ? duration : std::chrono::nanoseconds(0));
+
+    return timer_fd;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+timer::timerfd_arm(int timer_fd, std::chrono::nanoseconds value, std::chrono::nanoseconds interval, int flags)
+{
+    struct itimerspec ts;
+    ts.it_value.tv_sec = value.count() / 1000000000;
+    ts.it_value.tv_nsec = value.count() % 1000000000;
+    ts.it_interval.tv_sec = interval.count() / 1000000000;
+    ts.it_interval.tv_nsec = interval.count() % 1000000000;
 
-    res = timerfd_settime(timer_fd, 0, &ts, NULL);
+    int res = timerfd_settime(timer_fd, flags, &ts, NULL);
     if (res < 0) {
+        perror("timerfd_settime");
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+uint64_t
+timer::register_one_shot_timer(std::chrono::milliseconds duration)
+{
+    int timer_fd = timerfd_setup(duration, false);
+
+    epoll_add(timer_fd);
+
+    timer_id_++;
+    source_map_[timer_fd] = { timer_id_, source_type::one_shot_timer };
+    return timer_id_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+uint64_t
+timer::register_periodic_timer(std::chrono::nanoseconds period)
+{
+    auto id = register_timer();
+    set_period(id, period);
+    return id;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+timer::set_period(uint64_t id, std::chrono::nanoseconds period)
+{
+    if (period.count() <= 0) {
+        period = std::chrono::nanoseconds(1);
+    }
+
+    arm(id, period, period);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+uint64_t
+timer::register_timer()
+{
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        perror("timerfd_create");
     }
 
     epoll_add(timer_fd);
 
     timer_id_++;
-    timer_map_[timer_fd] = timer_id_;
+    source_map_[timer_fd] = { timer_id_, source_type::persistent_timer };
+    return timer_id_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+timer::arm(uint64_t id, std::chrono::nanoseconds value, std::chrono::nanoseconds interval)
+{
+    int timer_fd = fd_for_id(id);
+    if (timer_fd < 0) {
+        return;
+    }
+
+    if (value.count() <= 0) {
+        value = std::chrono::nanoseconds(1);
+    }
+
+    timerfd_arm(timer_fd, value, interval);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+timer::arm_at(uint64_t id, std::chrono::nanoseconds deadline)
+{
+    int timer_fd = fd_for_id(id);
+    if (timer_fd < 0) {
+        return;
+    }
+
+    // A deadline in the past fires right away, zero would disarm
+    if (deadline.count() <= 0) {
+        deadline = std::chrono::nanoseconds(1);
+    }
+
+    timerfd_arm(timer_fd, deadline, std::chrono::nanoseconds(0), TFD_TIMER_ABSTIME);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+timer::disarm(uint64_t id)
+{
+    int timer_fd = fd_for_id(id);
+    if (timer_fd < 0) {
+        return;
+    }
+
+    timerfd_arm(timer_fd, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0));
+
+    // Drop an expiration that is already pending
+    uint64_t expirations;
+    while (read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+uint64_t
+timer::register_fd(int fd)
+{
+    epoll_add(fd);
+
+    timer_id_++;
+    source_map_[fd] = { timer_id_, source_type::fd };
     return timer_id_;
 }
 
 //---------------------------------------------------------------------------------------------------------------------------
 
-std::shared_ptr<timer_event>
-timer::timerfd_handle_event(int fd)
+int
+timer::fd_for_id(uint64_t id)
 {
-    char buffer[4096];
-    ssize_t len = read(fd, buffer, sizeof(buffer));
+    for (auto&& s : source_map_) {
+        if (s.second.id == id) {
+            return s.first;
+        }
+    }
+
+    return -1;
+}
 
-    if (len <= 0) {
-        // throw exception
+//---------------------------------------------------------------------------------------------------------------------------
+
+bool
+timer::timerfd_handle_event(int fd, timer_event& event)
+{
+    auto it = source_map_.find(fd);
+    if (it == source_map_.end()) {
+        return false;
+    }
+
+    auto source = it->second;
+    if (source.type == source_type::fd) {
+        event = timer_event(source.id);
+        return true;
     }
 
-    auto it = timer_map_.find(fd);
-    if (it != timer_map_.end()) {
-        uint64_t id = timer_map_[fd];
-        return std::shared_ptr<timer_event>(new timer_event(id));
+    uint64_t expirations = 0;
+    ssize_t len = read(fd, &expirations, sizeof(expirations));
+    if (len != sizeof(expirations)) {
+        // Spurious wakeup (non-blocking fd)
+        return false;
     }
 
-    return nullptr;
+    if (source.type == source_type::one_shot_timer) {
+        epoll_remove(fd);
+        source_map_.erase(it);
+        close(fd);
+    }
+
+    event = timer_event(source.id, expirations);
+    return true;
 }
 
 //---------------------------------------------------------------------------------------------------------------------------
 
-std::vector<std::shared_ptr<timer_event>>
+event_span<timer_event>
 timer::wait_for_events()
 {
-    std::vector<std::shared_ptr<timer_event>> events;
-    struct epoll_event epoll_events[100];
+    events_.clear();
 
-    while (events.size() == 0) {
-        int res = epoll_wait(epoll_fd_, epoll_events_, 100, -1);
+    while (events_.empty()) {
+        int res = epoll_wait(epoll_fd_, epoll_events_, epoll_max_events, -1);
         if (res > 0) {
             // Go through epoll events
             for (int i = 0; i < res; i++) {
                 // Classify type of event and call handle function
                 int fd = epoll_events_[i].data.fd;
-                auto timer_event = timerfd_handle_event(fd);
-                events.push_back(timer_event);
-                close(fd);
+                timer_event event;
+                if (timerfd_handle_event(fd, event)) {
+                    events_.push(event);
+                }
             }
         } else if (res < 0) {
-            printf("epoll error\n");
+            if (errno != EINTR) {
+                printf("epoll error\n");
+            }
         } else {
             perror("Timed Out");
         }
     }
-    return events;
+    return events_.events();
 }
 
 //---------------------------------------------------------------------------------------------------------------------------
@@ -131,7 +294,32 @@ timer::epoll_add(int fd)
     ev.data.fd = fd;
     int res = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
     if (res < 0) {
+        perror("epoll_ctl");
     }
 }
 
 //---------------------------------------------------------------------------------------------------------------------------
+
+void
+timer::epoll_remove(int fd)
+{
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+timer::epoll_teardown()
+{
+    // External descriptors are owned by the caller
+    for (auto&& s : source_map_) {
+        if (s.second.type != source_type::fd) {
+            close(s.first);
+        }
+    }
+    source_map_.clear();
+
+    close(epoll_fd_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,80 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <stdio.h>
+
+#include <user_interface/headless_screen.hpp>
+
+headless_screen::headless_screen(int width, int height)
+    : screen(width, height)
+{
+    // Black like the X window background, and like a window without alpha
+    root_surface_ = std::shared_ptr<surface>(new surface(static_cast<double>(width), static_cast<double>(height), true));
+    root_surface_->load_background(0, 0, 0);
+}
+
+headless_screen::~headless_screen()
+{
+    if (!closed_) {
+        close();
+    }
+}
+
+void headless_screen::push_event(const ui_event& event)
+{
+    injected_.push(event);
+}
+
+event_span<ui_event> headless_screen::poll_events()
+{
+    for(auto&& event : injected_.events()) {
+        events_received_++;
+        events_.push(event);
+    }
+    injected_.clear();
+
+    return events_.events();
+}
+
+void headless_screen::present()
+{
+    auto handle = root_surface_->handle();
+    cairo_surface_flush(handle);
+
+    auto frame = frames_.load(std::memory_order_relaxed);
+    if (!frame_dump_dir_.empty()) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/frame_%06llu.png", frame_dump_dir_.c_str(),
+                 static_cast<unsigned long long>(frame));
+
+        auto status = cairo_surface_write_to_png(handle, path);
+        if (status != CAIRO_STATUS_SUCCESS) {
+            printf("%s: %s\n", path, cairo_status_to_string(status));
+        }
+    }
+    frames_.store(frame + 1, std::memory_order_relaxed);
+}
+
+void headless_screen::close()
+{
+    if (!closed_) {
+        root_surface_->destroy();
+        closed_ = true;
+    }
+}
@@ -24,4 +24,15 @@ screen::screen(int width, int height)
     , height_(height)
 {
 
-}
\ No newline at end of file
+}
+
+int64_t screen::server_to_local_ts(uint32_t ts)
+{
+    if (!server_time_calibrated_ || ts == 0) {
+        return 0;
+    }
+
+    // Server time wraps after 49.7 days, the difference does not
+    auto diff = static_cast<int32_t>(ts - calibration_server_ts_); // unit: ms
+    return calibration_local_ts_ + static_cast<int64_t>(diff) * 1000;
+}
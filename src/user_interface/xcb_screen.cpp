@@ -0,0 +1,498 @@
+/*
+ *  Dino Math
+ *
+ *  Copyright (C) 2020-2021 Johan Norberg <lonezor@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <common.hpp>
+#include <user_interface/xcb_screen.hpp>
+#include <profiler.hpp>
+
+// In atom enum order
+static const char* atom_names[] = {
+    "WM_PROTOCOLS",
+    "WM_DELETE_WINDOW",
+    "_NET_WM_STATE",
+    "_NET_WM_STATE_FULLSCREEN",
+    "_DINO_MATH_TIME",
+};
+
+// WM_SIZE_HINTS, see ICCCM 4.1.2.3
+constexpr int size_hints_fields = 18;
+constexpr uint32_t size_hints_position = 1 << 2; // PPosition
+constexpr uint32_t size_hints_size = 1 << 3;     // PSize
+
+constexpr uint16_t border_width = 5;
+
+xcb_screen::xcb_screen(int width, int height, int xpos, int ypos, std::string title, bool fullscreen)
+    : screen(width, height)
+{
+    int screen_nr = 0;
+    connection_ = xcb_connect(nullptr, &screen_nr);
+    if (xcb_connection_has_error(connection_)) {
+        printf("Cannot open X display\n");
+        exit(EXIT_FAILURE);
+    }
+
+    auto setup = xcb_get_setup(connection_);
+    auto screen_it = xcb_setup_roots_iterator(setup);
+    for(int i = 0; i < screen_nr; i++) {
+        xcb_screen_next(&screen_it);
+    }
+    auto x_screen = screen_it.data;
+
+    // Everything needed from the server goes out at once, the replies are
+    // collected after the window has been set up
+    std::array<xcb_intern_atom_cookie_t, nr_atoms> atom_cookies;
+    for(int i = 0; i < nr_atoms; i++) {
+        atom_cookies[i] = xcb_intern_atom(connection_, 0, strlen(atom_names[i]), atom_names[i]);
+    }
+
+    auto keymap_cookie = xcb_get_keyboard_mapping(connection_, setup->min_keycode,
+                                                  setup->max_keycode - setup->min_keycode + 1);
+
+    // Subscribe to input events
+    event_mask_ = XCB_EVENT_MASK_EXPOSURE |
+                  XCB_EVENT_MASK_POINTER_MOTION |
+                  XCB_EVENT_MASK_BUTTON_PRESS |
+                  XCB_EVENT_MASK_BUTTON_RELEASE |
+                  XCB_EVENT_MASK_KEY_PRESS |
+                  XCB_EVENT_MASK_KEY_RELEASE |
+                  XCB_EVENT_MASK_FOCUS_CHANGE |
+                  XCB_EVENT_MASK_ENTER_WINDOW |
+                  XCB_EVENT_MASK_LEAVE_WINDOW;
+
+    // Same window as xlib_screen: black background, white border
+    uint32_t values[] = { x_screen->black_pixel, x_screen->white_pixel, event_mask_ };
+
+    window_ = xcb_generate_id(connection_);
+    xcb_create_window(connection_, XCB_COPY_FROM_PARENT, window_, x_screen->root,
+                      static_cast<int16_t>(xpos), static_cast<int16_t>(ypos),
+                      static_cast<uint16_t>(width), static_cast<uint16_t>(height),
+                      border_width, XCB_WINDOW_CLASS_INPUT_OUTPUT, x_screen->root_visual,
+                      XCB_CW_BACK_PIXEL | XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK, values);
+
+    xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_, XCB_ATOM_WM_NAME,
+                        XCB_ATOM_STRING, 8, title.size(), title.c_str());
+    xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_, XCB_ATOM_WM_ICON_NAME,
+                        XCB_ATOM_STRING, 8, title.size(), title.c_str());
+
+    std::array<uint32_t, size_hints_fields> hints{};
+    hints[0] = size_hints_position | size_hints_size;
+    hints[1] = static_cast<uint32_t>(xpos);
+    hints[2] = static_cast<uint32_t>(ypos);
+    hints[3] = static_cast<uint32_t>(width);
+    hints[4] = static_cast<uint32_t>(height);
+    xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_, XCB_ATOM_WM_NORMAL_HINTS,
+                        XCB_ATOM_WM_SIZE_HINTS, 32, hints.size(), hints.data());
+
+    // The single round trip
+    for(int i = 0; i < nr_atoms; i++) {
+        auto reply = xcb_intern_atom_reply(connection_, atom_cookies[i], nullptr);
+        atoms_[i] = reply != nullptr ? reply->atom : static_cast<xcb_atom_t>(XCB_ATOM_NONE);
+        free(reply);
+    }
+
+    auto keymap_reply = xcb_get_keyboard_mapping_reply(connection_, keymap_cookie, nullptr);
+    set_keymap(keymap_reply);
+    free(keymap_reply);
+
+    // Subscribe to delete window event
+    xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_, atoms_[atom_wm_protocols],
+                        XCB_ATOM_ATOM, 32, 1, &atoms_[atom_wm_delete_window]);
+
+    // Set before mapping, the window manager applies it when it maps the
+    // window. No unmap and sync needed.
+    if (fullscreen) {
+        xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_, atoms_[atom_net_wm_state],
+                            XCB_ATOM_ATOM, 32, 1, &atoms_[atom_net_wm_state_fullscreen]);
+    }
+
+    // Raise window
+    uint32_t stack_mode = XCB_STACK_MODE_ABOVE;
+    xcb_map_window(connection_, window_);
+    xcb_configure_window(connection_, window_, XCB_CONFIG_WINDOW_STACK_MODE, &stack_mode);
+
+    // Connect cairo xcb surface to window
+    xcb_visualtype_t* visual = nullptr;
+    for(auto depth_it = xcb_screen_allowed_depths_iterator(x_screen); depth_it.rem > 0 && visual == nullptr; xcb_depth_next(&depth_it)) {
+        for(auto visual_it = xcb_depth_visuals_iterator(depth_it.data); visual_it.rem > 0; xcb_visualtype_next(&visual_it)) {
+            if (visual_it.data->visual_id == x_screen->root_visual) {
+                visual = visual_it.data;
+                break;
+            }
+        }
+    }
+
+    cairo_surface_t* xcb_surface = cairo_xcb_surface_create(connection_, window_, visual, width, height);
+    cairo_t* xcb_cr = cairo_create(xcb_surface);
+
+    root_surface_ = std::shared_ptr<surface>(new surface(xcb_surface, xcb_cr, static_cast<double>(width), static_cast<double>(height)));
+
+    xcb_flush(connection_);
+}
+
+xcb_screen::~xcb_screen()
+{
+    if (!closed_) {
+        close();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+void
+xcb_screen::set_keymap(xcb_get_keyboard_mapping_reply_t* reply)
+{
+    keymap_.clear();
+    keysyms_per_keycode_ = 0;
+    if (reply == nullptr) {
+        return;
+    }
+
+    auto keysyms = xcb_get_keyboard_mapping_keysyms(reply);
+    keymap_.assign(keysyms, keysyms + xcb_get_keyboard_mapping_keysyms_length(reply));
+    keysyms_per_keycode_ = reply->keysyms_per_keycode;
+    min_keycode_ = xcb_get_setup(connection_)->min_keycode;
+}
+
+void
+xcb_screen::reload_keymap()
+{
+    auto setup = xcb_get_setup(connection_);
+    auto cookie = xcb_get_keyboard_mapping(connection_, setup->min_keycode,
+                                           setup->max_keycode - setup->min_keycode + 1);
+    auto reply = xcb_get_keyboard_mapping_reply(connection_, cookie, nullptr);
+    set_keymap(reply);
+    free(reply);
+}
+
+char
+xcb_screen::key_char(xcb_keycode_t keycode, uint16_t state)
+{
+    auto index = static_cast<size_t>(keycode - min_keycode_) * keysyms_per_keycode_;
+    if (keycode < min_keycode_ || keysyms_per_keycode_ == 0 || index >= keymap_.size()) {
+        return 0;
+    }
+
+    // First column unshifted, second shifted
+    auto keysym = keymap_[index];
+    if ((state & XCB_MOD_MASK_SHIFT) && keysyms_per_keycode_ > 1 && keymap_[index + 1] != 0) {
+        keysym = keymap_[index + 1];
+    }
+
+    if ((state & XCB_MOD_MASK_LOCK) && keysym >= 'a' && keysym <= 'z') {
+        keysym -= 'a' - 'A';
+    }
+
+    // Printable Latin-1 keysyms are their character
+    if (keysym >= 0x20 && keysym <= 0x7e) {
+        return static_cast<char>(keysym);
+    }
+
+    // Keypad digits
+    if (keysym >= 0xffb0 && keysym <= 0xffb9) {
+        return static_cast<char>('0' + (keysym - 0xffb0));
+    }
+
+    switch(keysym) {
+        case 0xff08: // BackSpace
+            return 8;
+        case 0xff09: // Tab
+            return 9;
+        case 0xff0d: // Return
+        case 0xff8d: // KP_Enter
+            return 13;
+        case 0xff1b: // Escape
+            return 27;
+        case 0xffff: // Delete
+            return 127;
+        default:
+            return 0;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------------
+
+// Server timestamp of input events
+static uint32_t event_server_ts(xcb_generic_event_t* event)
+{
+    switch(event->response_type & ~0x80) {
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:
+            return reinterpret_cast<xcb_key_press_event_t*>(event)->time;
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:
+            return reinterpret_cast<xcb_button_press_event_t*>(event)->time;
+        case XCB_MOTION_NOTIFY:
+            return reinterpret_cast<xcb_motion_notify_event_t*>(event)->time;
+        case XCB_ENTER_NOTIFY:
+        case XCB_LEAVE_NOTIFY:
+            return reinterpret_cast<xcb_enter_notify_event_t*>(event)->time;
+        default:
+            return 0;
+    }
+}
+
+// Core protocol button numbers
+static const button x_buttons[] = {
+    button::none,
+    button::left,
+    button::middle, // (scroll wheel pressed)
+    button::right,
+    button::scroll_up,
+    button::scroll_down,
+    button::scroll_left,
+    button::scroll_right,
+    button::nav_back,
+    button::nav_forward,
+};
+
+void
+xcb_screen::handle_event(xcb_generic_event_t* event)
+{
+    auto nr_events = events_.size();
+
+    switch(event->response_type & ~0x80) {
+        case XCB_EXPOSE: {
+            events_.push(ui_event(ui_event_type::expose));
+            break;
+        }
+        case XCB_MOTION_NOTIFY: {
+            auto motion = reinterpret_cast<xcb_motion_notify_event_t*>(event);
+            if (!events_.empty() && events_.back().get_type() == ui_event_type::pointer_motion) {
+                events_.back().set_x(motion->event_x);
+                events_.back().set_y(motion->event_y);
+                break;
+            }
+
+            events_.push(ui_event(ui_event_type::pointer_motion,
+                                  motion->event_x,
+                                  motion->event_y));
+            break;
+        }
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE: {
+            auto press = reinterpret_cast<xcb_button_press_event_t*>(event);
+            bool pressed = ((event->response_type & ~0x80) == XCB_BUTTON_PRESS);
+            if (press->detail == 0 || press->detail >= sizeof(x_buttons) / sizeof(x_buttons[0])) {
+                printf("Unknown button %d\n", press->detail);
+                break;
+            }
+            button_event(x_buttons[press->detail], pressed);
+
+            events_.push(ui_event(pressed ? ui_event_type::button_press : ui_event_type::button_release,
+                                  press->event_x,
+                                  press->event_y,
+                                  button_state_));
+            break;
+        }
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE: {
+            auto key = reinterpret_cast<xcb_key_press_event_t*>(event);
+            auto c = key_char(key->detail, key->state);
+            if (c != 0) {
+                bool pressed = ((event->response_type & ~0x80) == XCB_KEY_PRESS);
+                events_.push(ui_event(pressed ? ui_event_type::key_press : ui_event_type::key_release, c));
+            }
+            break;
+        }
+        case XCB_FOCUS_IN: {
+            events_.push(ui_event(ui_event_type::focus_in));
+            break;
+        }
+        case XCB_FOCUS_OUT: {
+            events_.push(ui_event(ui_event_type::focus_out));
+            break;
+        }
+        case XCB_ENTER_NOTIFY: {
+            events_.push(ui_event(ui_event_type::enter));
+            break;
+        }
+        case XCB_LEAVE_NOTIFY: {
+            events_.push(ui_event(ui_event_type::leave));
+            break;
+        }
+        case XCB_CLIENT_MESSAGE: {
+            auto message = reinterpret_cast<xcb_client_message_event_t*>(event);
+            if (message->data.data32[0] == atoms_[atom_wm_delete_window]) {
+                events_.push(ui_event(ui_event_type::close));
+            }
+            break;
+        }
+        case XCB_MAPPING_NOTIFY: {
+            // Rare (keyboard layout switch), worth one round trip
+            auto mapping = reinterpret_cast<xcb_mapping_notify_event_t*>(event);
+            if (mapping->request == XCB_MAPPING_KEYBOARD) {
+                reload_keymap();
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    // Receive timestamp for latency measurements
+    if (events_.size() > nr_events) {
+        events_.back().set_receive_ts(get_ts());
+        events_.back().set_server_ts(event_server_ts(event));
+    }
+}
+
+event_span<ui_event> xcb_screen::poll_events()
+{
+    PROFILE_ZONE("xcb_screen::poll_events");
+
+    while(true) {
+        auto event = queued_event_;
+        queued_event_ = nullptr;
+        if (event == nullptr) {
+            event = xcb_poll_for_event(connection_);
+        }
+        if (event == nullptr) {
+            break;
+        }
+        events_received_++;
+
+        handle_event(event);
+        free(event);
+    }
+
+    return events_.events();
+}
+
+int xcb_screen::connection_fd()
+{
+    return xcb_get_file_descriptor(connection_);
+}
+
+bool xcb_screen::has_queued_events()
+{
+    if (queued_event_ == nullptr) {
+        queued_event_ = xcb_poll_for_queued_event(connection_);
+    }
+
+    return queued_event_ != nullptr;
+}
+
+void xcb_screen::present()
+{
+    PROFILE_ZONE("xcb_screen::present");
+
+    cairo_surface_flush(root_surface_->handle());
+    xcb_flush(connection_);
+}
+
+void xcb_screen::sync()
+{
+    // Any request with a reply works as a barrier
+    free(xcb_get_input_focus_reply(connection_, xcb_get_input_focus(connection_), nullptr));
+}
+
+std::shared_ptr<surface> xcb_screen::create_resident_surface(int width, int height, bool opaque)
+{
+    // cairo creates the Pixmap and its Picture, and frees them with the surface
+    auto handle = cairo_surface_create_similar(root_surface_->handle(),
+                                               opaque ? CAIRO_CONTENT_COLOR : CAIRO_CONTENT_COLOR_ALPHA,
+                                               width, height);
+    if (cairo_surface_status(handle) != CAIRO_STATUS_SUCCESS ||
+        cairo_surface_get_type(handle) != CAIRO_SURFACE_TYPE_XCB) {
+        cairo_surface_destroy(handle);
+        return nullptr;
+    }
+
+    return std::shared_ptr<surface>(new surface(handle, cairo_create(handle), static_cast<double>(width), static_cast<double>(height)));
+}
+
+void xcb_screen::calibrate_server_time()
+{
+    // The server stamps PropertyNotify with its current time. Keep the
+    // shortest of a few round trips, it has the least scheduling noise.
+    constexpr int nr_round_trips = 8;
+
+    auto atom = atoms_[atom_dino_math_time];
+    uint32_t event_mask = event_mask_ | XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_change_window_attributes(connection_, window_, XCB_CW_EVENT_MASK, &event_mask);
+
+    int64_t best_round_trip = 0;
+    for(int i = 0; i < nr_round_trips; i++) {
+        auto ts1 = get_ts();
+        xcb_change_property(connection_, XCB_PROP_MODE_APPEND, window_, atom, XCB_ATOM_INTEGER, 32, 0, nullptr);
+        xcb_flush(connection_);
+
+        // Input arriving meanwhile is kept
+        xcb_timestamp_t server_ts = 0;
+        bool received = false;
+        while (!received) {
+            auto event = xcb_wait_for_event(connection_);
+            if (event == nullptr) {
+                printf("X connection lost during server time calibration\n");
+                return;
+            }
+
+            auto property = reinterpret_cast<xcb_property_notify_event_t*>(event);
+            if ((event->response_type & ~0x80) == XCB_PROPERTY_NOTIFY && property->atom == atom) {
+                server_ts = property->time;
+                received = true;
+            } else {
+                events_received_++;
+                handle_event(event);
+            }
+            free(event);
+        }
+        auto ts2 = get_ts();
+
+        if (!server_time_calibrated_ || ts2 - ts1 < best_round_trip) {
+            best_round_trip = ts2 - ts1;
+            calibration_server_ts_ = static_cast<uint32_t>(server_ts);
+            calibration_local_ts_ = ts1 + (ts2 - ts1) / 2;
+            server_time_calibrated_ = true;
+        }
+    }
+
+    xcb_change_window_attributes(connection_, window_, XCB_CW_EVENT_MASK, &event_mask_);
+    xcb_delete_property(connection_, window_, atom);
+    xcb_flush(connection_);
+
+    printf("X server time calibrated, round trip %ld us\n", static_cast<long>(best_round_trip));
+}
+
+void xcb_screen::button_event(button flag, bool pressed)
+{
+    if (pressed) {
+        button_state_ |= flag;
+    } else {
+        button_state_ &= ~flag;
+    }
+}
+
+void xcb_screen::close()
+{
+    if (!closed_) {
+        root_surface_->destroy();
+        xcb_destroy_window(connection_, window_);
+        xcb_flush(connection_);
+        free(queued_event_);
+        queued_event_ = nullptr;
+        xcb_disconnect(connection_);
+        closed_ = true;
+    }
+}
@@ -23,12 +23,17 @@
 #include <iostream>
 #include <unistd.h>
 
+#include <common.hpp>
 #include <user_interface/xlib_screen.hpp>
+#include <profiler.hpp>
 
 xlib_screen::xlib_screen(int width, int height, int xpos, int ypos, std::string title, bool fullscreen)
     : screen(width, height)
 {
 
+    // Drawing is presented from the render thread while input is read here
+    XInitThreads();
+
     // Create window using default screen
     display_ = XOpenDisplay("");
 
@@ -101,6 +106,7 @@ xlib_screen::xlib_screen(int width, int height, int xpos, int ypos, std::string
     event_mask |= EnterWindowMask;
     event_mask |= LeaveWindowMask;
     XSelectInput(display_,window_,event_mask);
+    event_mask_ = event_mask;
 
     // Raise window
     XMapRaised(display_, window_);
@@ -133,9 +139,29 @@ xlib_screen::~xlib_screen()
     }
 }
 
-std::vector<std::shared_ptr<ui_event>> xlib_screen::poll_events()
+// Server timestamp of input events
+static uint32_t event_server_ts(const XEvent& event)
 {
-    std::vector<std::shared_ptr<ui_event>> events;
+    switch(event.type) {
+        case KeyPress:
+        case KeyRelease:
+            return static_cast<uint32_t>(event.xkey.time);
+        case ButtonPress:
+        case ButtonRelease:
+            return static_cast<uint32_t>(event.xbutton.time);
+        case MotionNotify:
+            return static_cast<uint32_t>(event.xmotion.time);
+        case EnterNotify:
+        case LeaveNotify:
+            return static_cast<uint32_t>(event.xcrossing.time);
+        default:
+            return 0;
+    }
+}
+
+event_span<ui_event> xlib_screen::poll_events()
+{
+    PROFILE_ZONE("xlib_screen::poll_events");
   XEvent event;
   memset(&event, 0, sizeof(event));
 
@@ -145,23 +171,29 @@ std::vector<std::shared_ptr<ui_event>> xlib_screen::poll_events()
   char text[10];
   memset(text, 0, sizeof(text));
 
-    while(true) {
-      auto event_in_queue = XCheckMaskEvent(display_, -1, &event);
-      if (!event_in_queue) {
-          break;
-      }
+    // XCheckMaskEvent() would leave ClientMessage and MappingNotify in
+    // the queue, they are not selected by any mask
+    while(XPending(display_) > 0) {
+      XNextEvent(display_, &event);
+      events_received_++;
+
+      auto nr_events = events_.size();
 
       switch(event.type) {
         case Expose: {
-            auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type::expose));
-            events.emplace_back(e);
+            events_.push(ui_event(ui_event_type::expose));
             break;
         }
         case MotionNotify: {
-            auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type::pointer_motion,
-                                  event.xbutton.x,
-                                  event.xbutton.y));
-            events.emplace_back(e);
+            if (!events_.empty() && events_.back().get_type() == ui_event_type::pointer_motion) {
+                events_.back().set_x(event.xmotion.x);
+                events_.back().set_y(event.xmotion.y);
+                break;
+            }
+
+            events_.push(ui_event(ui_event_type::pointer_motion,
+                                  event.xmotion.x,
+                                  event.xmotion.y));
             break;
         }
         case ButtonPress:
@@ -201,63 +233,136 @@ std::vector<std::shared_ptr<ui_event>> xlib_screen::poll_events()
             }
             ui_event_type ui_event_type = event.type == ButtonPress ? 
                 ui_event_type::button_press : ui_event_type::button_release;
-            auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type,
+            events_.push(ui_event(ui_event_type,
                                   event.xbutton.x,
                                   event.xbutton.y,
                                   button_state_));
-            events.emplace_back(e);
             break;
         }
         case KeyPress: {
             auto i = XLookupString((XKeyEvent*)&event, text, sizeof(text), &key, 0);
             if (i == 1) {
-                auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type::key_press,
+                events_.push(ui_event(ui_event_type::key_press,
                                       text[0]));
-                events.emplace_back(e);
             }
             break;
         }
         case KeyRelease: {
             auto i = XLookupString((XKeyEvent*)&event, text, sizeof(text), &key, 0);
             if (i == 1) {
-                auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type::key_release,
+                events_.push(ui_event(ui_event_type::key_release,
                                       text[0]));
-                events.emplace_back(e);
             }
             break;
         }
         case FocusIn: {
-            auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type::focus_in));
-            events.emplace_back(e);
+            events_.push(ui_event(ui_event_type::focus_in));
             break;
         }
         case FocusOut: {
-            auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type::focus_out));
-            events.emplace_back(e);
+            events_.push(ui_event(ui_event_type::focus_out));
             break;
         }
         case EnterNotify: {
-            auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type::enter));
-            events.emplace_back(e);
+            events_.push(ui_event(ui_event_type::enter));
             break;
         }
         case LeaveNotify: {
-            auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type::leave));
-            events.emplace_back(e);
+            events_.push(ui_event(ui_event_type::leave));
             break;
         }
-        case ClientMessage: // TODO: currently is acquired only with XNextEvent() but not XCheckWindowEvent()
-            if (event.xclient.data.l[0] == wm_delete_) {
-                auto e = std::shared_ptr<ui_event>(new ui_event(ui_event_type::close,
-                                      text[0]));
-                events.emplace_back(e);
+        case ClientMessage: {
+            if (static_cast<Atom>(event.xclient.data.l[0]) == wm_delete_) {
+                events_.push(ui_event(ui_event_type::close));
             }
+            break;
+        }
+        case MappingNotify: {
+            XRefreshKeyboardMapping(&event.xmapping);
+            break;
+        }
         default:
             break;
     }
+
+      // Receive timestamp for latency measurements
+      if (events_.size() > nr_events) {
+          events_.back().set_receive_ts(get_ts());
+          events_.back().set_server_ts(event_server_ts(event));
+      }
   }
-    return events;
+    return events_.events();
+
+}
+
+int xlib_screen::connection_fd()
+{
+    return ConnectionNumber(display_);
+}
+
+bool xlib_screen::has_queued_events()
+{
+    return XEventsQueued(display_, QueuedAlready) > 0;
+}
+
+void xlib_screen::present()
+{
+    PROFILE_ZONE("xlib_screen::present");
+
+    cairo_surface_flush(root_surface_->handle());
+    XFlush(display_);
+}
+
+void xlib_screen::sync()
+{
+    XSync(display_, False);
+}
+
+std::shared_ptr<surface> xlib_screen::create_resident_surface(int width, int height, bool opaque)
+{
+    // cairo creates the Pixmap and its Picture, and frees them with the surface
+    auto handle = cairo_surface_create_similar(root_surface_->handle(),
+                                               opaque ? CAIRO_CONTENT_COLOR : CAIRO_CONTENT_COLOR_ALPHA,
+                                               width, height);
+    if (cairo_surface_status(handle) != CAIRO_STATUS_SUCCESS ||
+        cairo_surface_get_type(handle) != CAIRO_SURFACE_TYPE_XLIB) {
+        cairo_surface_destroy(handle);
+        return nullptr;
+    }
+
+    return std::shared_ptr<surface>(new surface(handle, cairo_create(handle), static_cast<double>(width), static_cast<double>(height)));
+}
+
+void xlib_screen::calibrate_server_time()
+{
+    // The server stamps PropertyNotify with its current time. Keep the
+    // shortest of a few round trips, it has the least scheduling noise.
+    constexpr int nr_round_trips = 8;
+
+    Atom atom = XInternAtom(display_, "_DINO_MATH_TIME", False);
+    XSelectInput(display_, window_, event_mask_ | PropertyChangeMask);
+
+    int64_t best_round_trip = 0;
+    for(int i = 0; i < nr_round_trips; i++) {
+        auto ts1 = get_ts();
+        XChangeProperty(display_, window_, atom, XA_INTEGER, 32, PropModeAppend, nullptr, 0);
+
+        XEvent event;
+        XWindowEvent(display_, window_, PropertyChangeMask, &event);
+        auto ts2 = get_ts();
+
+        if (!server_time_calibrated_ || ts2 - ts1 < best_round_trip) {
+            best_round_trip = ts2 - ts1;
+            calibration_server_ts_ = static_cast<uint32_t>(event.xproperty.time);
+            calibration_local_ts_ = ts1 + (ts2 - ts1) / 2;
+            server_time_calibrated_ = true;
+        }
+    }
+
+    XSelectInput(display_, window_, event_mask_);
+    XDeleteProperty(display_, window_, atom);
 
+    printf("X server time calibrated, round trip %ld us\n", static_cast<long>(best_round_trip));
 }
 
 void xlib_screen::button_event(button flag, bool pressed)